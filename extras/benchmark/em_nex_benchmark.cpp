@@ -0,0 +1,211 @@
+// Host (Linux) throughput and latency benchmark of 'EmNextion' command
+// paths against the simulated display (see 'extras/simulator').
+//
+// Build (from library root, EmCore host build sources in <EmCore>):
+//
+//   g++ -std=c++11 -O2 -Iinclude -Iextras/simulator -I<EmCore>/include
+//       extras/benchmark/em_nex_benchmark.cpp
+//       extras/simulator/em_nex_simulator.cpp
+//       src/em_nextion.cpp <EmCore>/src/*.cpp -o em_nex_benchmark
+//
+// Run:
+//
+//   ./em_nex_benchmark [iterations] [max_ms_per_case] > results.csv
+//
+// NOTES:
+//  1. one CSV row per (scenario, baud, payload): operations per second
+//     and p50/p99 latency in microseconds
+//  2. display time is simulated in real time, low bauds cases are
+//     bounded by 'max_ms_per_case'
+//  3. 'EM_NEX_BENCH_VERSION' tags the rows (e.g. -DEM_NEX_BENCH_VERSION=\"1.1.0\")
+//     so that results of different library versions can be compared
+//  4. each baud case restarts display at 9600 bauds and reaches the
+//     case bauds by 'Negotiate' (host bauds are modeled by simulator)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "em_nextion.h"
+#include "em_nex_simulator.h"
+
+#ifndef EM_NEX_BENCH_VERSION
+#define EM_NEX_BENCH_VERSION "1.1.0"
+#endif
+
+static const uint32_t BENCH_BAUDS[] = { 9600, 115200, 921600 };
+static const uint16_t BENCH_TEXT_LENS[] = { 8, 64, 240 };
+static const uint16_t BENCH_MAX_TEXT_LEN = 240;
+static const uint8_t PAGE_NUMBERS = 8;
+static const uint8_t PAGE_TEXTS = 4;
+static const char* NUMBER_NAMES[PAGE_NUMBERS] = { "n0", "n1", "n2", "n3", "n4", "n5", "n6", "n7" };
+static const char* TEXT_NAMES[PAGE_TEXTS] = { "t0", "t1", "t2", "t3" };
+
+EmNexSimulator simulator;
+EmNextion display(simulator, 100);
+EmNexPage mainPage(display, 0, "main");
+EmNexDecimal<mainPage> decimal("d0", "d1", 2);
+
+typedef std::chrono::steady_clock BenchClock;
+
+// One CSV row key
+struct BenchCase {
+    const char* scenario;
+    uint32_t baud;
+    uint16_t payload;
+};
+
+static uint64_t _elapsedUs(BenchClock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        BenchClock::now() - start).count();
+}
+
+static uint64_t _percentile(std::vector<uint64_t>& samples, uint32_t pct)
+{
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t idx = (samples.size() - 1) * pct / 100;
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+}
+
+// 'op(i)' is timed until 'iterations' runs or 'maxMs' elapsed
+template<class operation_type>
+static void _run(const BenchCase& bench,
+                 uint32_t iterations,
+                 uint32_t maxMs,
+                 operation_type op)
+{
+    std::vector<uint64_t> samples;
+    samples.reserve(iterations);
+    uint32_t failures = 0;
+    uint32_t bytesIn = simulator.BytesIn();
+    uint32_t bytesOut = simulator.BytesOut();
+    BenchClock::time_point start = BenchClock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        BenchClock::time_point opStart = BenchClock::now();
+        if (!op(i)) {
+            failures++;
+            // Let's recover as an application would do
+            display.Init();
+        }
+        samples.push_back(_elapsedUs(opStart));
+        if (_elapsedUs(start) >= static_cast<uint64_t>(maxMs)*1000) {
+            break;
+        }
+    }
+    uint64_t totalUs = _elapsedUs(start);
+    printf("%s,%s,%lu,%u,%zu,%u,%.1f,%llu,%llu,%lu,%lu\n",
+           EM_NEX_BENCH_VERSION,
+           bench.scenario,
+           static_cast<unsigned long>(bench.baud),
+           bench.payload,
+           samples.size(),
+           failures,
+           (0 == totalUs) ? 0.0 : samples.size()*1e6/totalUs,
+           static_cast<unsigned long long>(_percentile(samples, 50)),
+           static_cast<unsigned long long>(_percentile(samples, 99)),
+           static_cast<unsigned long>(simulator.BytesIn() - bytesIn),
+           static_cast<unsigned long>(simulator.BytesOut() - bytesOut));
+    fflush(stdout);
+}
+
+static bool _setBaud(uint32_t baud, void*)
+{
+    simulator.SetHostBaud(baud);
+    return true;
+}
+
+static void _setupDisplay()
+{
+    EmNexSimConfig& config = simulator.Config();
+    config.processingUs = 500;
+    config.jitterUs = 200;
+    simulator.AddPage(0, "main");
+    uint8_t id = 1;
+    for (uint8_t i = 0; i < PAGE_NUMBERS; i++) {
+        simulator.AddComponent(0, id++, NUMBER_NAMES[i]);
+    }
+    for (uint8_t i = 0; i < PAGE_TEXTS; i++) {
+        simulator.AddComponent(0, id++, TEXT_NAMES[i]);
+    }
+    simulator.AddComponent(0, id++, "d0");
+    simulator.AddComponent(0, id++, "d1");
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t iterations = (argc > 1) ? atol(argv[1]) : 200;
+    uint32_t maxMs = (argc > 2) ? atol(argv[2]) : 3000;
+
+    _setupDisplay();
+    printf("version,scenario,baud,payload,ops,failures,ops_per_sec,p50_us,p99_us,bytes_to_display,bytes_from_display\n");
+
+    for (size_t b = 0; b < sizeof(BENCH_BAUDS)/sizeof(BENCH_BAUDS[0]); b++) {
+        uint32_t baud = BENCH_BAUDS[b];
+        // Display restarts at 9600 bauds (host is still at previous ones)
+        simulator.Config().baud = 9600;
+        if (!display.Negotiate(_setBaud, NULL, baud) || display.Baud() != baud) {
+            fprintf(stderr, "Negotiation at %lu bauds failed\n", static_cast<unsigned long>(baud));
+            continue;
+        }
+
+        BenchCase setNum = { "set_num", baud, 4 };
+        _run(setNum, iterations, maxMs, [](uint32_t i) {
+            return display.SetNumElementValue("main", "n0", static_cast<int32_t>(i));
+        });
+
+        BenchCase getNum = { "get_num", baud, 4 };
+        _run(getNum, iterations, maxMs, [](uint32_t) {
+            int32_t value = 0;
+            return EmGetValueResult::failed != display.GetNumElementValue("main", "n0", value);
+        });
+
+        BenchCase setVisible = { "set_visible", baud, 1 };
+        _run(setVisible, iterations, maxMs, [](uint32_t i) {
+            return display.SetVisible(0, "n1", 0 == (i & 1));
+        });
+
+        BenchCase setDecimal = { "decimal_set", baud, 8 };
+        _run(setDecimal, iterations, maxMs, [](uint32_t i) {
+            return decimal.SetValue(i/100.0);
+        });
+
+        for (size_t l = 0; l < sizeof(BENCH_TEXT_LENS)/sizeof(BENCH_TEXT_LENS[0]); l++) {
+            uint16_t len = BENCH_TEXT_LENS[l];
+            std::string text(len, 'x');
+
+            BenchCase setText = { "set_text", baud, len };
+            _run(setText, iterations, maxMs, [&text](uint32_t i) {
+                text[0] = 'a' + (i % 26);
+                return display.SetTextElementValue("main", "t0", text.c_str());
+            });
+
+            BenchCase getText = { "get_text", baud, len };
+            _run(getText, iterations, maxMs, [](uint32_t) {
+                char txt[BENCH_MAX_TEXT_LEN + 1] = {0};
+                return EmGetValueResult::failed != display.GetTextElementValue<BENCH_MAX_TEXT_LEN>("main", "t0", txt);
+            });
+
+            // Full page refresh: all numbers and texts, batched writes
+            BenchCase refresh = { "page_refresh", baud, len };
+            _run(refresh, iterations, maxMs, [&text](uint32_t i) {
+                EmNexBatch<128> batch(display);
+                bool res = true;
+                for (uint8_t n = 0; n < PAGE_NUMBERS; n++) {
+                    res = display.SetNumElementValue("main", NUMBER_NAMES[n], static_cast<int32_t>(i + n)) && res;
+                }
+                for (uint8_t t = 0; t < PAGE_TEXTS; t++) {
+                    res = display.SetTextElementValue("main", TEXT_NAMES[t], text.c_str()) && res;
+                }
+                return batch.Commit() && res;
+            });
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,600 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <chrono>
+#include <algorithm>
+
+#include "em_nex_simulator.h"
+
+
+// Nextion return codes
+static const uint8_t NEX_INVALID_CMD = 0x00;
+static const uint8_t NEX_SUCCEED = 0x01;
+static const uint8_t NEX_INVALID_COMPONENT = 0x02;
+static const uint8_t NEX_INVALID_PAGE = 0x03;
+static const uint8_t NEX_INVALID_VARIABLE = 0x1A;
+static const uint8_t NEX_TOUCH = 0x65;
+static const uint8_t NEX_PAGE = 0x66;
+static const uint8_t NEX_STRING = 0x70;
+static const uint8_t NEX_NUMBER = 0x71;
+static const uint8_t NEX_SLEEP = 0x86;
+static const uint8_t NEX_WAKE_UP = 0x87;
+static const uint8_t NEX_READY = 0x88;
+static const uint8_t NEX_TRANSPARENT_DONE = 0xFD;
+static const uint8_t NEX_TRANSPARENT_READY = 0xFE;
+
+// System variables (e.g. "dim", "thup") component
+static const char* SYSTEM = "";
+
+static bool _startsWith(const std::string& str, const char* prefix)
+{
+    return 0 == str.compare(0, strlen(prefix), prefix);
+}
+
+static bool _isNumber(const std::string& str)
+{
+    if (str.empty()) {
+        return false;
+    }
+    size_t i = ('-' == str[0]) ? 1 : 0;
+    if (i == str.size()) {
+        return false;
+    }
+    for (; i < str.size(); i++) {
+        if (str[i] < '0' || str[i] > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Parse "<prefix>[<index>]" (e.g. "p[2]")
+static bool _indexed(const std::string& str, char prefix, uint8_t& index)
+{
+    if (str.size() < 4 || str[0] != prefix || str[1] != '[' ||
+        str[str.size()-1] != ']') {
+        return false;
+    }
+    std::string num = str.substr(2, str.size()-3);
+    if (!_isNumber(num)) {
+        return false;
+    }
+    index = static_cast<uint8_t>(atoi(num.c_str()));
+    return true;
+}
+
+EmNexSimulator::EmNexSimulator(const EmNexSimConfig& config)
+ : m_config(config),
+   m_rand(config.seed),
+   m_hostBaud(0),
+   m_txFreeUs(0),
+   m_rxFreeUs(0),
+   m_busyUs(0),
+   m_terminators(0),
+   m_rawLeft(0),
+   m_rawComponent(0),
+   m_rawChannel(0),
+   m_bkcmd(2),
+   m_curPage(0),
+   m_refreshStopped(false),
+   m_sleeping(false),
+   m_commands(0),
+   m_bytesIn(0),
+   m_writes(0),
+   m_bytesOut(0),
+   m_redraws(0)
+{
+    m_components[SYSTEM].pageId = 0;
+    m_components[SYSTEM].id = 0;
+    m_components[SYSTEM].global = true;
+}
+
+void EmNexSimulator::AddPage(uint8_t pageId, const char* pageName)
+{
+    m_pages[pageName] = pageId;
+}
+
+void EmNexSimulator::AddComponent(uint8_t pageId,
+                                  uint8_t componentId,
+                                  const char* name,
+                                  bool global)
+{
+    Component& component = m_components[_key(pageId, name)];
+    component.pageId = pageId;
+    component.id = componentId;
+    component.global = global;
+}
+
+void EmNexSimulator::SetNumber(const char* path, int32_t value)
+{
+    std::string attr;
+    Component* component = _resolve(path, attr);
+    if (NULL != component) {
+        component->numbers[attr] = value;
+    }
+}
+
+void EmNexSimulator::SetText(const char* path, const char* text)
+{
+    std::string attr;
+    Component* component = _resolve(path, attr);
+    if (NULL != component) {
+        component->texts[attr] = text;
+    }
+}
+
+bool EmNexSimulator::GetNumber(const char* path, int32_t& value) const
+{
+    std::string attr;
+    const Component* component = const_cast<EmNexSimulator*>(this)->_resolve(path, attr);
+    if (NULL == component || 0 == component->numbers.count(attr)) {
+        return false;
+    }
+    value = component->numbers.at(attr);
+    return true;
+}
+
+bool EmNexSimulator::GetText(const char* path, std::string& text) const
+{
+    std::string attr;
+    const Component* component = const_cast<EmNexSimulator*>(this)->_resolve(path, attr);
+    if (NULL == component || 0 == component->texts.count(attr)) {
+        return false;
+    }
+    text = component->texts.at(attr);
+    return true;
+}
+
+void EmNexSimulator::Touch(uint8_t componentId, bool pressed)
+{
+    uint8_t payload[] = { m_curPage, componentId, pressed ? uint8_t(1) : uint8_t(0) };
+    _reply(NEX_TOUCH, payload, sizeof(payload));
+}
+
+void EmNexSimulator::ChangePage(uint8_t pageId)
+{
+    m_curPage = pageId;
+    _redraw();
+    _reply(NEX_PAGE, &pageId, 1);
+}
+
+void EmNexSimulator::Sleep(bool sleep)
+{
+    m_sleeping = sleep;
+    _reply(sleep ? NEX_SLEEP : NEX_WAKE_UP);
+}
+
+void EmNexSimulator::Reset()
+{
+    m_bkcmd = 2;
+    m_curPage = 0;
+    m_refreshStopped = false;
+    m_sleeping = false;
+    m_cmd.clear();
+    m_terminators = 0;
+    m_rawLeft = 0;
+    // Startup (00 00 00 FF FF FF) and ready frames
+    uint8_t startup[] = { 0x00, 0x00 };
+    _reply(0x00, startup, sizeof(startup));
+    _reply(NEX_READY);
+}
+
+const std::vector<uint8_t>& EmNexSimulator::Waveform(uint8_t componentId,
+                                                     uint8_t channel) const
+{
+    static const std::vector<uint8_t> empty;
+    std::map<uint16_t, std::vector<uint8_t>>::const_iterator it =
+        m_waveforms.find((componentId << 8) | channel);
+    return (it != m_waveforms.end()) ? it->second : empty;
+}
+
+int EmNexSimulator::available()
+{
+    uint64_t now = _nowUs();
+    int count = 0;
+    for (std::deque<RxByte>::const_iterator it = m_rx.begin();
+         it != m_rx.end() && it->readyUs <= now;
+         ++it) {
+        count++;
+    }
+    return count;
+}
+
+int EmNexSimulator::read()
+{
+    if (m_rx.empty() || m_rx.front().readyUs > _nowUs()) {
+        return -1;
+    }
+    uint8_t b = m_rx.front().value;
+    m_rx.pop_front();
+    return b;
+}
+
+size_t EmNexSimulator::write(uint8_t b)
+{
+    m_writes++;
+    _feed(b);
+    return 1;
+}
+
+size_t EmNexSimulator::write(const uint8_t* buf, size_t size)
+{
+    m_writes++;
+    for (size_t i = 0; i < size; i++) {
+        _feed(buf[i]);
+    }
+    return size;
+}
+
+size_t EmNexSimulator::write(const char* str)
+{
+    return write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+}
+
+void EmNexSimulator::flush()
+{
+}
+
+uint64_t EmNexSimulator::_nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void EmNexSimulator::_feed(uint8_t b)
+{
+    b = _line(b);
+    m_bytesIn++;
+    // Command is complete once its last byte got through the line
+    uint64_t now = _nowUs();
+    if (m_rxFreeUs < now) {
+        m_rxFreeUs = now;
+    }
+    m_rxFreeUs += 10000000ULL / m_config.baud;
+    if (m_rawLeft) {
+        // Transparent data ('addt')
+        m_waveforms[(m_rawComponent << 8) | m_rawChannel].push_back(b);
+        if (0 == --m_rawLeft) {
+            _startExec();
+            _redraw(true);
+            _reply(NEX_TRANSPARENT_DONE);
+        }
+        return;
+    }
+    if (0xFF == b) {
+        if (3 == ++m_terminators) {
+            m_terminators = 0;
+            std::string cmd;
+            cmd.swap(m_cmd);
+            _exec(cmd);
+        }
+        return;
+    }
+    // Single 0xFF bytes belong to the command
+    m_cmd.append(m_terminators, static_cast<char>(0xFF));
+    m_terminators = 0;
+    m_cmd += static_cast<char>(b);
+}
+
+void EmNexSimulator::_exec(const std::string& cmd)
+{
+    m_commands++;
+    m_log.push_back(cmd);
+    _startExec();
+
+    if (cmd.empty()) {
+        _ack(NEX_INVALID_CMD);
+        return;
+    }
+    if (_startsWith(cmd, "bkcmd=")) {
+        m_bkcmd = static_cast<uint8_t>(atoi(cmd.c_str() + 6));
+        _ack(NEX_SUCCEED);
+        return;
+    }
+    if (_startsWith(cmd, "baud=") || _startsWith(cmd, "bauds=")) {
+        // Feedback is sent at previous bauds
+        _ack(NEX_SUCCEED);
+        m_config.baud = atol(cmd.c_str() + cmd.find('=') + 1);
+        return;
+    }
+    if ("sendme" == cmd) {
+        _reply(NEX_PAGE, &m_curPage, 1);
+        return;
+    }
+    if ("ref_stop" == cmd || "ref_star" == cmd) {
+        m_refreshStopped = ("ref_stop" == cmd);
+        if (!m_refreshStopped) {
+            _redraw(true);
+        }
+        _ack(NEX_SUCCEED);
+        return;
+    }
+    if (_startsWith(cmd, "page ")) {
+        std::string page = cmd.substr(5);
+        if (_isNumber(page)) {
+            m_curPage = static_cast<uint8_t>(atoi(page.c_str()));
+        } else if (m_pages.count(page)) {
+            m_curPage = m_pages[page];
+        } else {
+            _ack(NEX_INVALID_PAGE);
+            return;
+        }
+        // Display is busy drawing the page (next commands wait)
+        m_busyUs += m_config.pageUs;
+        _redraw();
+        _ack(NEX_SUCCEED);
+        return;
+    }
+    if (_startsWith(cmd, "vis ") || _startsWith(cmd, "click ")) {
+        size_t sep = cmd.find(' ');
+        size_t comma = cmd.find(',');
+        std::string name = cmd.substr(sep + 1, comma - sep - 1);
+        bool found = false;
+        for (std::map<std::string, Component>::iterator it = m_components.begin();
+             it != m_components.end();
+             ++it) {
+            if (it->second.pageId == m_curPage &&
+                it->first != SYSTEM &&
+                (it->first == _key(m_curPage, name) ||
+                 (_isNumber(name) && atoi(name.c_str()) == it->second.id))) {
+                found = true;
+                if ('v' == cmd[0]) {
+                    it->second.numbers["vis"] = atoi(cmd.c_str() + comma + 1);
+                    _redraw();
+                }
+            }
+        }
+        _ack(found ? NEX_SUCCEED : NEX_INVALID_COMPONENT);
+        return;
+    }
+    if (_startsWith(cmd, "get ")) {
+        bool isText = false;
+        int32_t num = 0;
+        std::string txt;
+        if (!_eval(cmd.substr(4), isText, num, txt)) {
+            _ack(NEX_INVALID_VARIABLE);
+        } else if (isText) {
+            _reply(NEX_STRING, reinterpret_cast<const uint8_t*>(txt.data()), txt.size());
+        } else {
+            uint8_t payload[4];
+            for (int i = 0; i < 4; i++) {
+                payload[i] = static_cast<uint8_t>(static_cast<uint32_t>(num) >> (8*i));
+            }
+            _reply(NEX_NUMBER, payload, sizeof(payload));
+        }
+        return;
+    }
+    if (_startsWith(cmd, "substr ")) {
+        // substr <src>,<dest>,<start>,<count>
+        std::vector<std::string> args;
+        size_t start = 7;
+        size_t comma;
+        while (std::string::npos != (comma = cmd.find(',', start))) {
+            args.push_back(cmd.substr(start, comma - start));
+            start = comma + 1;
+        }
+        args.push_back(cmd.substr(start));
+        bool isText = false;
+        int32_t num = 0;
+        std::string txt;
+        if (4 != args.size() || !_eval(args[0], isText, num, txt) || !isText) {
+            _ack(NEX_INVALID_VARIABLE);
+            return;
+        }
+        size_t from = atoi(args[2].c_str());
+        txt = (from < txt.size()) ? txt.substr(from, atoi(args[3].c_str())) : "";
+        _ack(_assign(args[1], "\"" + txt + "\"", false) ? NEX_SUCCEED : NEX_INVALID_VARIABLE);
+        return;
+    }
+    if (_startsWith(cmd, "add ") || _startsWith(cmd, "addt ")) {
+        int id = 0, ch = 0, val = 0;
+        bool raw = _startsWith(cmd, "addt ");
+        if (3 != sscanf(cmd.c_str() + (raw ? 5 : 4), "%d,%d,%d", &id, &ch, &val)) {
+            _ack(NEX_INVALID_CMD);
+            return;
+        }
+        if (raw) {
+            m_rawComponent = static_cast<uint8_t>(id);
+            m_rawChannel = static_cast<uint8_t>(ch);
+            m_rawLeft = val;
+            _reply(NEX_TRANSPARENT_READY);
+            if (0 == m_rawLeft) {
+                _reply(NEX_TRANSPARENT_DONE);
+            }
+        } else {
+            m_waveforms[(id << 8) | ch].push_back(static_cast<uint8_t>(val));
+            _redraw(true);
+            _ack(NEX_SUCCEED);
+        }
+        return;
+    }
+    size_t eq = cmd.find('=');
+    if (std::string::npos != eq && eq > 0) {
+        bool append = ('+' == cmd[eq-1]);
+        std::string lhs = cmd.substr(0, append ? eq-1 : eq);
+        if (_assign(lhs, cmd.substr(eq+1), append)) {
+            _redraw();
+            _ack(NEX_SUCCEED);
+        } else {
+            _ack(NEX_INVALID_VARIABLE);
+        }
+        return;
+    }
+    _ack(NEX_INVALID_CMD);
+}
+
+bool EmNexSimulator::_isSuccessAck(uint8_t code) const
+{
+    return NEX_SUCCEED == code;
+}
+
+void EmNexSimulator::_ack(uint8_t code)
+{
+    // 'bkcmd': 0 none, 1 on success, 2 on failure, 3 always
+    bool send = _isSuccessAck(code) ? (m_bkcmd & 1) : (m_bkcmd & 2);
+    if (send) {
+        _reply(code);
+    }
+}
+
+void EmNexSimulator::_startExec()
+{
+    // Commands are executed one after the other once received
+    uint64_t startUs = std::max(std::max(_nowUs(), m_rxFreeUs), m_busyUs);
+    m_busyUs = startUs + m_config.processingUs;
+    if (m_config.jitterUs) {
+        m_busyUs += std::uniform_int_distribution<uint32_t>(0, m_config.jitterUs)(m_rand);
+    }
+}
+
+void EmNexSimulator::_reply(uint8_t code, const uint8_t* payload, size_t len)
+{
+    uint64_t byteUs = 10000000ULL / m_config.baud;
+    // Replies are sent once command is executed (events at once)
+    uint64_t startUs = std::max(_nowUs(), m_busyUs);
+    // Frames are sent one after the other
+    if (startUs < m_txFreeUs) {
+        startUs = m_txFreeUs;
+    }
+    std::uniform_real_distribution<double> chance(0, 1);
+    std::vector<uint8_t> frame;
+    if (m_config.garbageRate > 0 && chance(m_rand) < m_config.garbageRate) {
+        frame.push_back(static_cast<uint8_t>(std::uniform_int_distribution<int>(0, 0xFE)(m_rand)));
+    }
+    frame.push_back(code);
+    frame.insert(frame.end(), payload, payload + len);
+    frame.insert(frame.end(), 3, 0xFF);
+    for (size_t i = 0; i < frame.size(); i++) {
+        startUs += byteUs;
+        if (m_config.dropRate > 0 && chance(m_rand) < m_config.dropRate) {
+            continue;
+        }
+        RxByte rxByte = { startUs, _line(frame[i]) };
+        m_rx.push_back(rxByte);
+        m_bytesOut++;
+    }
+    m_txFreeUs = startUs;
+}
+
+uint8_t EmNexSimulator::_line(uint8_t b) const
+{
+    // Mismatching bauds: byte is misread (terminators included)
+    return (0 == m_hostBaud || m_hostBaud == m_config.baud) ? b : (b ^ 0x5A);
+}
+
+std::string EmNexSimulator::_key(uint8_t pageId, const std::string& name) const
+{
+    return std::to_string(pageId) + "." + name;
+}
+
+EmNexSimulator::Component* EmNexSimulator::_resolve(const std::string& ref,
+                                                    std::string& attr)
+{
+    size_t dot = ref.rfind('.');
+    if (std::string::npos == dot) {
+        // System variable
+        attr = ref;
+        return &m_components[SYSTEM];
+    }
+    attr = ref.substr(dot + 1);
+    std::string object = ref.substr(0, dot);
+
+    // "<page>.<component>" or "<component>" of current page
+    uint8_t pageId = m_curPage;
+    bool explicitPage = false;
+    size_t pageDot = object.find('.');
+    if (std::string::npos != pageDot) {
+        std::string page = object.substr(0, pageDot);
+        object = object.substr(pageDot + 1);
+        explicitPage = true;
+        if (m_pages.count(page)) {
+            pageId = m_pages[page];
+        } else if (!_indexed(page, 'p', pageId)) {
+            return NULL;
+        }
+    }
+    Component* component = NULL;
+    uint8_t componentId;
+    if (_indexed(object, 'b', componentId)) {
+        for (std::map<std::string, Component>::iterator it = m_components.begin();
+             it != m_components.end();
+             ++it) {
+            if (it->first != SYSTEM &&
+                it->second.pageId == pageId &&
+                it->second.id == componentId) {
+                component = &it->second;
+            }
+        }
+    } else {
+        std::map<std::string, Component>::iterator it = m_components.find(_key(pageId, object));
+        if (it != m_components.end()) {
+            component = &it->second;
+        }
+    }
+    // Local components of other pages can't be reached
+    if (NULL != component && explicitPage &&
+        component->pageId != m_curPage && !component->global) {
+        return NULL;
+    }
+    return component;
+}
+
+bool EmNexSimulator::_eval(const std::string& expr,
+                           bool& isText,
+                           int32_t& num,
+                           std::string& txt)
+{
+    if (expr.size() >= 2 && '"' == expr[0] && '"' == expr[expr.size()-1]) {
+        isText = true;
+        txt = expr.substr(1, expr.size()-2);
+        return true;
+    }
+    if (_isNumber(expr)) {
+        isText = false;
+        num = atoi(expr.c_str());
+        return true;
+    }
+    std::string attr;
+    Component* component = _resolve(expr, attr);
+    if (NULL == component) {
+        return false;
+    }
+    isText = ("txt" == attr || "path" == attr);
+    if (isText) {
+        txt = component->texts[attr];
+    } else {
+        num = component->numbers[attr];
+    }
+    return true;
+}
+
+bool EmNexSimulator::_assign(const std::string& lhs,
+                             const std::string& rhs,
+                             bool append)
+{
+    std::string attr;
+    Component* component = _resolve(lhs, attr);
+    bool isText = false;
+    int32_t num = 0;
+    std::string txt;
+    if (NULL == component || !_eval(rhs, isText, num, txt)) {
+        return false;
+    }
+    if (isText != ("txt" == attr || "path" == attr)) {
+        return false;
+    }
+    if (isText) {
+        component->texts[attr] = append ? component->texts[attr] + txt : txt;
+    } else {
+        component->numbers[attr] = append ? component->numbers[attr] + num : num;
+    }
+    return true;
+}
+
+void EmNexSimulator::_redraw(bool waveform)
+{
+    // 'ref_stop' pauses waveforms refresh only
+    if (!waveform || !m_refreshStopped) {
+        m_redraws++;
+    }
+}
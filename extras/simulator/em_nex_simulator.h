@@ -0,0 +1,169 @@
+#ifndef __EM_NEX_SIMULATOR_H
+#define __EM_NEX_SIMULATOR_H
+
+// Host (Linux) Nextion display simulator: 'EmNextion' talks to it as to
+// a serial line so that the library can be exercised and measured
+// without hardware.
+//
+// NOTES:
+//  1. it is not part of the library build (i.e. 'extras' folder),
+//     build it along with the library sources and an host build
+//     of EmCore (e.g. see 'extras/benchmark')
+//  2. display time is simulated: commands are executed one after 
+//     the other once their bytes got through the line at current 
+//     bauds, replies are available after the processing delay, 
+//     jitter and their own transfer time
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <random>
+
+#include "em_com_device.h"
+
+
+// Simulated display settings
+struct EmNexSimConfig {
+    uint32_t baud = 9600;
+    // Command processing time (microseconds) and its random jitter
+    uint32_t processingUs = 500;
+    uint32_t jitterUs = 0;
+    // Page change ('page' command) extra processing time
+    uint32_t pageUs = 0;
+    // Probability (0..1) a byte sent by display is lost, and a
+    // garbage byte is injected before a display frame
+    double dropRate = 0;
+    double garbageRate = 0;
+    // Random generator seed (runs are reproducible)
+    uint32_t seed = 1;
+};
+
+class EmNexSimulator: public EmComSerial {
+public:
+    EmNexSimulator(const EmNexSimConfig& config = EmNexSimConfig());
+
+    // Components model (attributes are created when first set)
+    void AddPage(uint8_t pageId, const char* pageName);
+    void AddComponent(uint8_t pageId,
+                      uint8_t componentId,
+                      const char* name,
+                      bool global = false);
+    void SetNumber(const char* path, int32_t value);
+    void SetText(const char* path, const char* text);
+    bool GetNumber(const char* path, int32_t& value) const;
+    bool GetText(const char* path, std::string& text) const;
+
+    // Unsolicited display frames (e.g. user touching a button)
+    void Touch(uint8_t componentId, bool pressed);
+    void ChangePage(uint8_t pageId);
+    void Sleep(bool sleep);
+    void Reset();
+
+    uint8_t CurPage() const {
+        return m_curPage;
+    }
+
+    bool IsRefreshStopped() const {
+        return m_refreshStopped;
+    }
+
+    // Host serial bauds (0: always matches display bauds). Bytes sent
+    // at a baud rate not matching display's one are garbled both ways
+    // (e.g. to exercise 'EmNextion::Negotiate').
+    void SetHostBaud(uint32_t baud) {
+        m_hostBaud = baud;
+    }
+
+    const EmNexSimConfig& Config() const {
+        return m_config;
+    }
+
+    EmNexSimConfig& Config() {
+        return m_config;
+    }
+
+    // Waveform data received by 'add'/'addt' ('componentId', 'channel')
+    const std::vector<uint8_t>& Waveform(uint8_t componentId,
+                                         uint8_t channel) const;
+
+    // Statistics
+    uint32_t Commands() const { return m_commands; }
+    uint32_t BytesIn() const { return m_bytesIn; }
+    // Host serial write calls
+    uint32_t Writes() const { return m_writes; }
+    uint32_t BytesOut() const { return m_bytesOut; }
+    // Screen redraws (waveforms ones are paused by 'ref_stop')
+    uint32_t Redraws() const { return m_redraws; }
+    const std::vector<std::string>& Log() const { return m_log; }
+    void ClearLog() { m_log.clear(); }
+
+    // EmComSerial
+    virtual int available() override;
+    virtual int read() override;
+    virtual size_t write(uint8_t b) override;
+    virtual size_t write(const uint8_t* buf, size_t size) override;
+    virtual size_t write(const char* str) override;
+    virtual void flush() override;
+
+protected:
+    struct Component {
+        uint8_t pageId;
+        uint8_t id;
+        bool global;
+        std::map<std::string, int32_t> numbers;
+        std::map<std::string, std::string> texts;
+    };
+
+    struct RxByte {
+        uint64_t readyUs;
+        uint8_t value;
+    };
+
+    static uint64_t _nowUs();
+    void _feed(uint8_t b);
+    void _exec(const std::string& cmd);
+    void _startExec();
+    void _reply(uint8_t code, const uint8_t* payload = NULL, size_t len = 0);
+    void _ack(uint8_t code);
+    bool _isSuccessAck(uint8_t code) const;
+    Component* _resolve(const std::string& ref, std::string& attr);
+    std::string _key(uint8_t pageId, const std::string& name) const;
+    bool _assign(const std::string& lhs, const std::string& rhs, bool append);
+    bool _eval(const std::string& expr, bool& isText, int32_t& num, std::string& txt);
+    void _redraw(bool waveform = false);
+    uint8_t _line(uint8_t b) const;
+
+    EmNexSimConfig m_config;
+    std::mt19937 m_rand;
+    // Display to host bytes (with their availability time)
+    std::deque<RxByte> m_rx;
+    uint32_t m_hostBaud;
+    uint64_t m_txFreeUs;
+    // Host to display command being received (and when it ends)
+    uint64_t m_rxFreeUs;
+    // Display executes commands until then
+    uint64_t m_busyUs;
+    std::string m_cmd;
+    uint8_t m_terminators;
+    uint32_t m_rawLeft;
+    uint8_t m_rawComponent;
+    uint8_t m_rawChannel;
+    // Display state
+    uint8_t m_bkcmd;
+    uint8_t m_curPage;
+    bool m_refreshStopped;
+    bool m_sleeping;
+    std::map<std::string, uint8_t> m_pages;
+    std::map<std::string, Component> m_components;
+    std::map<uint16_t, std::vector<uint8_t>> m_waveforms;
+    // Statistics
+    uint32_t m_commands;
+    uint32_t m_bytesIn;
+    uint32_t m_writes;
+    uint32_t m_bytesOut;
+    uint32_t m_redraws;
+    std::vector<std::string> m_log;
+};
+
+#endif
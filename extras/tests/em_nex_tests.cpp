@@ -0,0 +1,827 @@
+// Host (Linux) automated tests of 'EmNextion' against the simulated
+// display (see 'extras/simulator').
+//
+// Build (from library root, EmCore host build sources in <EmCore>):
+//
+//   g++ -std=c++11 -O2 -Iinclude -Iextras/simulator -I<EmCore>/include
+//       extras/tests/em_nex_tests.cpp
+//       extras/simulator/em_nex_simulator.cpp
+//       src/em_nextion.cpp <EmCore>/src/*.cpp -o em_nex_tests
+//
+// Run:
+//
+//   ./em_nex_tests [test_name]
+//
+// NOTES:
+//  1. exit code is the number of failed tests (0: all passed)
+//  2. display time is simulated in real time, random line errors
+//     are reproducible (see 'EmNexSimConfig::seed')
+//  3. build with -DEM_NEX_STATS to run link statistics tests too
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "em_nextion.h"
+#include "em_nex_simulator.h"
+
+static uint32_t s_checks = 0;
+static uint32_t s_failures = 0;
+
+#define EM_NEX_CHECK(cond) _check((cond), #cond, __LINE__)
+
+static void _check(bool cond, const char* text, int line)
+{
+    s_checks++;
+    if (!cond) {
+        s_failures++;
+        printf("  line %d: check failed: %s\n", line, text);
+    }
+}
+
+// Display model shared by tests: page 0 "main" (numbers n0..n3,
+// texts t0..t1, waveform s0) and page 1 "cfg"
+static void _setupDisplay(EmNexSimulator& simulator)
+{
+    simulator.Config().baud = 115200;
+    simulator.Config().processingUs = 300;
+    simulator.AddPage(0, "main");
+    simulator.AddPage(1, "cfg");
+    simulator.AddComponent(0, 1, "n0");
+    simulator.AddComponent(0, 2, "n1");
+    simulator.AddComponent(0, 3, "n2");
+    simulator.AddComponent(0, 4, "n3");
+    simulator.AddComponent(0, 5, "t0");
+    simulator.AddComponent(0, 6, "t1");
+    simulator.AddComponent(0, 7, "s0");
+}
+
+// Async callbacks results (in completion order)
+struct AsyncLog {
+    std::vector<int> ids;
+    std::vector<EmGetValueResult> results;
+};
+
+struct AsyncCall {
+    AsyncLog* log;
+    int id;
+};
+
+static void _onAsync(EmGetValueResult result, void* context)
+{
+    AsyncCall* call = static_cast<AsyncCall*>(context);
+    call->log->ids.push_back(call->id);
+    call->log->results.push_back(result);
+}
+
+// Replies are matched to commands in FIFO order, failed commands
+// don't shift following replies
+static void _testFifoMatching()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    simulator.SetNumber("main.n0.val", 10);
+    simulator.SetNumber("main.n1.val", 11);
+    EmNextion display(simulator, 100);
+    EM_NEX_CHECK(display.Init());
+
+    AsyncLog log;
+    AsyncCall calls[4] = { { &log, 0 }, { &log, 1 }, { &log, 2 }, { &log, 3 } };
+    int32_t n0 = 0;
+    int32_t n1 = 0;
+    EM_NEX_CHECK(display.SetNumElementValueAsync("main", "n2", 12, _onAsync, &calls[0]));
+    EM_NEX_CHECK(display.GetNumElementValueAsync("main", "n0", n0, _onAsync, &calls[1]));
+    EM_NEX_CHECK(display.SetNumElementValueAsync("main", "zz", 1, _onAsync, &calls[2]));
+    EM_NEX_CHECK(display.GetNumElementValueAsync("main", "n1", n1, _onAsync, &calls[3]));
+    // Blocking get reply comes after pending ones
+    int32_t n2 = 0;
+    EM_NEX_CHECK(EmGetValueResult::failed != display.GetNumElementValue("main", "n2", n2));
+    EM_NEX_CHECK(12 == n2);
+    EM_NEX_CHECK(0 == display.PendingCount());
+
+    EM_NEX_CHECK(4 == log.ids.size());
+    for (size_t i = 0; i < log.ids.size(); i++) {
+        EM_NEX_CHECK(static_cast<int>(i) == log.ids[i]);
+        EM_NEX_CHECK((2 == i) == (EmGetValueResult::failed == log.results[i]));
+    }
+    EM_NEX_CHECK(10 == n0);
+    EM_NEX_CHECK(11 == n1);
+}
+
+struct TagLog {
+    std::vector<uint16_t> tags;
+    std::vector<EmNextionRet> rets;
+};
+
+static void _onCmd(uint16_t cmdTag, EmNextionRet ret, void* context)
+{
+    TagLog* log = static_cast<TagLog*>(context);
+    log->tags.push_back(cmdTag);
+    log->rets.push_back(ret);
+}
+
+// Batches are written at once whatever the pending commands limit, 
+// their feedbacks keep commands order and tags
+static void _testBatchSingleWrite()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    EmNextion display(simulator, 100);
+    EM_NEX_CHECK(display.Init());
+
+    char buf[512];
+    uint32_t writes = simulator.Writes();
+    EM_NEX_CHECK(display.BeginBatch(buf, sizeof(buf)));
+    for (int32_t i = 0; i < 20; i++) {
+        EM_NEX_CHECK(display.SetNumElementValue("main", "n0", 200 + i));
+    }
+    EM_NEX_CHECK(display.CommitBatch());
+    EM_NEX_CHECK(1 == simulator.Writes() - writes);
+    EM_NEX_CHECK(0 == display.PendingCount());
+    int32_t value = 0;
+    EM_NEX_CHECK(simulator.GetNumber("main.n0.val", value) && 219 == value);
+
+    // Pipelined: failures are reported to their own command
+    TagLog log;
+    display.SetPipelined(true, _onCmd, &log);
+    uint16_t failedTag = 0;
+    writes = simulator.Writes();
+    EM_NEX_CHECK(display.BeginBatch(buf, sizeof(buf)));
+    for (int32_t i = 0; i < 20; i++) {
+        EM_NEX_CHECK(display.SetNumElementValue("main", (7 == i) ? "zz" : "n1", i));
+        if (7 == i) {
+            failedTag = display.LastCmdTag();
+        }
+    }
+    uint16_t lastTag = display.LastCmdTag();
+    // NOTE: failure might be known already
+    display.CommitBatch();
+    EM_NEX_CHECK(1 == simulator.Writes() - writes);
+    EM_NEX_CHECK(!display.WaitPending());
+    EM_NEX_CHECK(20 == log.tags.size());
+    for (size_t i = 0; i < log.tags.size(); i++) {
+        EM_NEX_CHECK(static_cast<uint16_t>(lastTag - 19 + i) == log.tags[i]);
+        EM_NEX_CHECK((failedTag == log.tags[i]) == (ACK_CMD_SUCCEED != log.rets[i]));
+    }
+    display.SetPipelined(false);
+}
+
+// Batches don't wait for commands in flight, their failures are not
+// batch failures
+static void _testBatchBehindPending()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    EmNextion display(simulator, 100);
+    EM_NEX_CHECK(display.Init());
+    simulator.Config().processingUs = 10000;
+
+    char buf[128];
+    for (int pass = 0; pass < 2; pass++) {
+        bool failuresOnly = (1 == pass);
+        AsyncLog log;
+        AsyncCall calls[2] = { { &log, 0 }, { &log, 1 } };
+        display.ResetFailedCount();
+        EM_NEX_CHECK(display.SetNumElementValueAsync("main", "zz", 1, _onAsync, &calls[0]));
+        EM_NEX_CHECK(display.SetNumElementValueAsync("main", "n0", 40 + pass, _onAsync, &calls[1]));
+
+        uint32_t startMs = millis();
+        EM_NEX_CHECK(display.BeginBatch(buf, sizeof(buf), failuresOnly));
+        EM_NEX_CHECK(millis() - startMs < 5);
+        EM_NEX_CHECK(display.SetNumElementValue("main", "n1", 50 + pass));
+        EM_NEX_CHECK(display.SetNumElementValue("main", "n2", 60 + pass));
+        EM_NEX_CHECK(display.CommitBatch());
+        EM_NEX_CHECK(0 == display.PendingCount());
+        EM_NEX_CHECK(1 == display.FailedCount());
+        EM_NEX_CHECK(2 == log.ids.size());
+        EM_NEX_CHECK(2 == log.results.size() && 
+                     EmGetValueResult::failed == log.results[0] &&
+                     EmGetValueResult::failed != log.results[1]);
+        int32_t value = 0;
+        EM_NEX_CHECK(simulator.GetNumber("main.n0.val", value) && 40 + pass == value);
+        EM_NEX_CHECK(simulator.GetNumber("main.n2.val", value) && 60 + pass == value);
+    }
+    // Batch failures are still reported
+    display.ResetFailedCount();
+    EM_NEX_CHECK(display.SetNumElementValueAsync("main", "n0", 1));
+    EM_NEX_CHECK(display.BeginBatch(buf, sizeof(buf)));
+    EM_NEX_CHECK(display.SetNumElementValue("main", "zz", 1));
+    EM_NEX_CHECK(!display.CommitBatch());
+    EM_NEX_CHECK(1 == display.FailedCount());
+}
+
+// Only failed commands are acknowledged within 'failuresOnly' batches
+static void _testFailuresOnlyBatch()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    EmNextion display(simulator, 100);
+    EM_NEX_CHECK(display.Init());
+
+    char buf[128];
+    EM_NEX_CHECK(display.BeginBatch(buf, sizeof(buf), true));
+    EM_NEX_CHECK(display.SetNumElementValue("main", "n0", 20));
+    EM_NEX_CHECK(display.SetNumElementValue("main", "zz", 1));
+    EM_NEX_CHECK(display.SetNumElementValue("main", "n1", 21));
+    EM_NEX_CHECK(!display.CommitBatch());
+    EM_NEX_CHECK(1 == display.FailedCount());
+    EM_NEX_CHECK(INVALID_VARIABLE == display.LastError());
+
+    int32_t value = 0;
+    EM_NEX_CHECK(simulator.GetNumber("main.n0.val", value) && 20 == value);
+    EM_NEX_CHECK(simulator.GetNumber("main.n1.val", value) && 21 == value);
+
+    display.ResetFailedCount();
+    EM_NEX_CHECK(display.BeginBatch(buf, sizeof(buf), true));
+    EM_NEX_CHECK(display.SetNumElementValue("main", "n2", 22));
+    EM_NEX_CHECK(display.SetTextElementValue("main", "t0", "batch"));
+    EM_NEX_CHECK(display.CommitBatch());
+    EM_NEX_CHECK(0 == display.FailedCount());
+    std::string text;
+    EM_NEX_CHECK(simulator.GetText("main.t0.txt", text) && "batch" == text);
+}
+
+// Gets within 'failuresOnly' batches are not matched to previous
+// commands failures
+static void _testFailuresOnlyBatchGet()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    simulator.SetNumber("main.n1.val", 31);
+    EmNextion display(simulator, 100);
+    EM_NEX_CHECK(display.Init());
+
+    char buf[128];
+    int32_t value = 0;
+    EM_NEX_CHECK(display.BeginBatch(buf, sizeof(buf), true));
+    EM_NEX_CHECK(display.SetNumElementValue("main", "n0", 30));
+    EM_NEX_CHECK(display.SetNumElementValue("main", "zz", 1));
+    EM_NEX_CHECK(EmGetValueResult::failed != display.GetNumElementValue("main", "n1", value));
+    EM_NEX_CHECK(31 == value);
+    EM_NEX_CHECK(EmGetValueResult::failed == display.GetNumElementValue("main", "zz", value));
+    EM_NEX_CHECK(display.SetNumElementValue("main", "n2", 32));
+    EM_NEX_CHECK(!display.CommitBatch());
+    EM_NEX_CHECK(display.IsInit());
+    EM_NEX_CHECK(simulator.GetNumber("main.n0.val", value) && 30 == value);
+    EM_NEX_CHECK(simulator.GetNumber("main.n2.val", value) && 32 == value);
+
+    // Display feedback level is restored
+    display.ResetFailedCount();
+    EM_NEX_CHECK(display.SetNumElementValue("main", "n3", 33));
+    EM_NEX_CHECK(!display.SetNumElementValue("main", "zz", 1));
+    EM_NEX_CHECK(EmGetValueResult::failed != display.GetNumElementValue("main", "n1", value));
+    EM_NEX_CHECK(31 == value);
+}
+
+// Batch end deadline includes the batch transfer time
+static void _testFailuresOnlyBatchSlowLine()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    simulator.Config().baud = 9600;
+    EmNextion display(simulator, 50);
+    EM_NEX_CHECK(display.Init());
+
+    // About 600 bytes (more than 600 ms at 9600 bauds)
+    char buf[1024];
+    EM_NEX_CHECK(display.BeginBatch(buf, sizeof(buf), true));
+    for (int32_t i = 0; i < 30; i++) {
+        EM_NEX_CHECK(display.SetNumElementValue("main", "n0", 1000 + i));
+    }
+    EM_NEX_CHECK(display.CommitBatch());
+    EM_NEX_CHECK(display.IsInit());
+    int32_t value = 0;
+    EM_NEX_CHECK(simulator.GetNumber("main.n0.val", value) && 1029 == value);
+}
+
+// Line errors never deliver a wrong value and the link recovers
+static void _testResync(double garbageRate, double dropRate)
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    simulator.SetNumber("main.n0.val", -1);
+    simulator.Config().garbageRate = garbageRate;
+    simulator.Config().dropRate = dropRate;
+    EmNextion display(simulator, 50);
+
+    uint32_t succeeded = 0;
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < 200; i++) {
+        int32_t value = 0;
+        if (!display.IsInit() && !display.Init()) {
+            continue;
+        }
+        if (EmGetValueResult::failed != display.GetNumElementValue("main", "n0", value)) {
+            succeeded++;
+            wrong += (-1 != value) ? 1 : 0;
+        }
+    }
+    EM_NEX_CHECK(0 == wrong);
+    EM_NEX_CHECK(succeeded >= 180);
+
+    // Clean line: everything works again
+    simulator.Config().garbageRate = 0;
+    simulator.Config().dropRate = 0;
+    int32_t value = 0;
+    EM_NEX_CHECK(display.Init());
+    EM_NEX_CHECK(EmGetValueResult::failed != display.GetNumElementValue("main", "n0", value));
+    EM_NEX_CHECK(-1 == value);
+}
+
+static void _testResyncGarbage()
+{
+    _testResync(0.2, 0);
+}
+
+static void _testResyncDrops()
+{
+    _testResync(0, 0.002);
+}
+
+// Page elements need a global display
+EmNexSimulator pageSimulator;
+EmNextion pageDisplay(pageSimulator, 100);
+EmNexPage mainPage(pageDisplay, 0, "main");
+EmNexConsole<mainPage, 12, 3> console("t0");
+EmNexGauge<mainPage> gauge("n3", 0, 100, 0, 180);
+EmNexText<mainPage> label("t1");
+EmNexWaveform<mainPage, 2, 8> waveform("s0", 7);
+EmNexInteger<mainPage> number("n2");
+int32_t numberValue = 0;
+EmNexValueOf<EmNexInteger<mainPage>> numberOf(number, numberValue);
+
+// Oldest console lines are cut by 'max_lines' and 'capacity'
+static void _testConsoleTrim()
+{
+    _setupDisplay(pageSimulator);
+    EM_NEX_CHECK(pageDisplay.Init());
+    std::string text;
+
+    EM_NEX_CHECK(console.Clear());
+    EM_NEX_CHECK(console.Append("a1\r"));
+    EM_NEX_CHECK(console.Append("b2\r"));
+    EM_NEX_CHECK(console.Append("c3\r"));
+    EM_NEX_CHECK(pageSimulator.GetText("main.t0.txt", text) && "a1\rb2\rc3\r" == text);
+    // Max lines
+    EM_NEX_CHECK(console.Append("d4\r"));
+    EM_NEX_CHECK(pageSimulator.GetText("main.t0.txt", text) && "b2\rc3\rd4\r" == text);
+    EM_NEX_CHECK(9 == console.Len());
+    // Capacity
+    EM_NEX_CHECK(console.Append("eeeeee\r"));
+    EM_NEX_CHECK(pageSimulator.GetText("main.t0.txt", text) && "d4\reeeeee\r" == text);
+    EM_NEX_CHECK(10 == console.Len());
+    // Only the tail of a too long text fits
+    EM_NEX_CHECK(console.Append("0123456789abcdef"));
+    EM_NEX_CHECK(pageSimulator.GetText("main.t0.txt", text) && "456789abcdef" == text);
+    // Unknown display text is replaced
+    pageDisplay.InvalidateShadows();
+    EM_NEX_CHECK(console.Append("f5\r"));
+    EM_NEX_CHECK(pageSimulator.GetText("main.t0.txt", text) && "f5\r" == text);
+}
+
+// Gated async updates complete at once
+static void _testGaugeGatedAsync()
+{
+    _setupDisplay(pageSimulator);
+    EM_NEX_CHECK(pageDisplay.Init());
+
+    AsyncLog log;
+    AsyncCall calls[2] = { { &log, 0 }, { &log, 1 } };
+    EM_NEX_CHECK(gauge.SetValue(50));
+    uint32_t commands = pageSimulator.Commands();
+    // Same angle: nothing is sent
+    EM_NEX_CHECK(gauge.SetValueAsync(50.1, _onAsync, &calls[0]));
+    EM_NEX_CHECK(1 == log.ids.size() && EmGetValueResult::succeedEqualValue == log.results[0]);
+    EM_NEX_CHECK(commands == pageSimulator.Commands());
+
+    EM_NEX_CHECK(gauge.SetValueAsync(60, _onAsync, &calls[1]));
+    EM_NEX_CHECK(pageDisplay.WaitPending());
+    EM_NEX_CHECK(2 == log.ids.size() && EmGetValueResult::failed != log.results[1]);
+    int32_t angle = 0;
+    EM_NEX_CHECK(pageSimulator.GetNumber("main.n3.val", angle) && 108 == angle);
+}
+
+// Text shadow skips only unchanged texts
+static void _testTextShadow()
+{
+    _setupDisplay(pageSimulator);
+    EM_NEX_CHECK(pageDisplay.Init());
+    label.SetShadowed(true);
+    std::string text;
+
+    const char* texts[] = { "ON", "OFF", "", "O", "OFF!", "OFF?" };
+    for (size_t i = 0; i < sizeof(texts)/sizeof(texts[0]); i++) {
+        EM_NEX_CHECK(label.SetValue(texts[i]));
+        uint32_t commands = pageSimulator.Commands();
+        EM_NEX_CHECK(label.SetValue(texts[i]));
+        EM_NEX_CHECK(commands == pageSimulator.Commands());
+        EM_NEX_CHECK(pageSimulator.GetText("main.t1.txt", text) && texts[i] == text);
+    }
+    EM_NEX_CHECK(EmNexTextHash("ON") != EmNexTextHash("ON\x80"));
+    EM_NEX_CHECK(EmNexTextHash("") != EmNexTextHash("\x01"));
+
+    // Truncated reads don't confirm the shown text
+    EM_NEX_CHECK(label.SetValue("Hello World"));
+    char value[6] = "";
+    EM_NEX_CHECK(EmGetValueResult::failed != label.GetValue<5>(value));
+    EM_NEX_CHECK(0 == strcmp("Hello", value));
+    EM_NEX_CHECK(label.SetValue(value));
+    EM_NEX_CHECK(pageSimulator.GetText("main.t1.txt", text) && "Hello" == text);
+    // Whole text does
+    EM_NEX_CHECK(label.SetValue("Hi"));
+    EM_NEX_CHECK(EmGetValueResult::failed != label.GetValue<5>(value));
+    uint32_t commands = pageSimulator.Commands();
+    EM_NEX_CHECK(label.SetValue("Hi"));
+    EM_NEX_CHECK(commands == pageSimulator.Commands());
+}
+
+// Waveform samples are sent in order, buffers wrap and discard
+// samples exceeding their size
+static void _testWaveformRing()
+{
+    _setupDisplay(pageSimulator);
+    EM_NEX_CHECK(pageDisplay.Init());
+
+    uint8_t value = 0;
+    for (uint8_t i = 0; i < 6; i++) {
+        EM_NEX_CHECK(waveform.AddValue(0, value++));
+    }
+    EM_NEX_CHECK(6 == waveform.Count(0) && 0 == waveform.Count(1));
+    EM_NEX_CHECK(waveform.Flush());
+    for (uint8_t i = 0; i < 10; i++) {
+        EM_NEX_CHECK((i < 8) == waveform.AddValue(0, value++));
+    }
+    EM_NEX_CHECK(!waveform.AddValue(2, 0));
+    EM_NEX_CHECK(8 == waveform.Count(0));
+    EM_NEX_CHECK(waveform.Flush());
+    EM_NEX_CHECK(0 == waveform.Count(0));
+
+    const std::vector<uint8_t>& data = pageSimulator.Waveform(7, 0);
+    EM_NEX_CHECK(14 == data.size());
+    for (size_t i = 0; i < data.size(); i++) {
+        EM_NEX_CHECK(i == data[i]);
+    }
+}
+
+// Async gets complete by 'Poll' and report value changes
+static void _testAsyncCallbacks()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    simulator.SetNumber("main.n3.val", 33);
+    simulator.SetText("main.t1.txt", "async");
+    EmNextion display(simulator, 100);
+    EM_NEX_CHECK(display.Init());
+
+    AsyncLog log;
+    AsyncCall calls[3] = { { &log, 0 }, { &log, 1 }, { &log, 2 } };
+    int32_t value = 0;
+    char text[16] = {0};
+    EM_NEX_CHECK(display.GetNumElementValueAsync("main", "n3", value, _onAsync, &calls[0]));
+    EM_NEX_CHECK(display.GetTextElementValueAsync("main", "t1", text, sizeof(text), _onAsync, &calls[1]));
+    EM_NEX_CHECK(log.ids.empty());
+    EmTimeout timeout(1000);
+    while (log.ids.size() < 2 && !timeout.IsElapsed(false)) {
+        display.Poll();
+    }
+    EM_NEX_CHECK(2 == log.ids.size());
+    EM_NEX_CHECK(33 == value);
+    EM_NEX_CHECK(0 == strcmp("async", text));
+    EM_NEX_CHECK(EmGetValueResult::succeedNotEqualValue == log.results[0]);
+
+    // Same value again
+    EM_NEX_CHECK(display.GetNumElementValueAsync("main", "n3", value, _onAsync, &calls[2]));
+    EM_NEX_CHECK(display.WaitPending());
+    EM_NEX_CHECK(3 == log.ids.size() && EmGetValueResult::succeedEqualValue == log.results[2]);
+}
+
+// Blocking get called by a callback run while a blocking get waits
+struct NestedGet {
+    const EmNextion* display;
+    EmGetValueResult result;
+    int32_t value;
+};
+
+static void _onNestedGet(EmGetValueResult, void* context)
+{
+    NestedGet* nested = static_cast<NestedGet*>(context);
+    nested->result = nested->display->GetNumElementValue("main", "n2", nested->value);
+}
+
+// Each blocking wait gets its own reply (callbacks may call blocking
+// methods while another blocking method is waiting)
+static void _testBlockingGetInCallback()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    simulator.SetNumber("main.n0.val", 40);
+    simulator.SetNumber("main.n1.val", 41);
+    simulator.SetNumber("main.n2.val", 42);
+    EmNextion display(simulator, 100);
+    EM_NEX_CHECK(display.Init());
+
+    NestedGet nested = { &display, EmGetValueResult::failed, 0 };
+    int32_t n1 = 0;
+    EM_NEX_CHECK(display.GetNumElementValueAsync("main", "n1", n1, _onNestedGet, &nested));
+    int32_t n0 = 0;
+    EM_NEX_CHECK(EmGetValueResult::failed != display.GetNumElementValue("main", "n0", n0));
+    EM_NEX_CHECK(40 == n0);
+    EM_NEX_CHECK(41 == n1);
+    EM_NEX_CHECK(EmGetValueResult::failed != nested.result);
+    EM_NEX_CHECK(42 == nested.value);
+    EM_NEX_CHECK(0 == display.PendingCount());
+
+    // Replies keep matching their commands
+    int32_t n2 = 0;
+    EM_NEX_CHECK(EmGetValueResult::failed != display.GetNumElementValue("main", "n2", n2));
+    EM_NEX_CHECK(42 == n2);
+}
+
+// Gets and sets of 'n0' keep matching their own replies
+static void _checkInSync(EmNextion& display, EmNexSimulator& simulator)
+{
+    for (int32_t i = 0; i < 5; i++) {
+        int32_t value = -1;
+        EM_NEX_CHECK(display.SetNumElementValue("main", "n0", 100 + i));
+        EM_NEX_CHECK(EmGetValueResult::failed != display.GetNumElementValue("main", "n0", value));
+        EM_NEX_CHECK(100 + i == value);
+    }
+    int32_t value = 0;
+    EM_NEX_CHECK(simulator.GetNumber("main.n0.val", value) && 104 == value);
+}
+
+// Page commands have their own latency class, 'TimeoutMs' is the
+// replies deadline floor and late replies are skipped by 'Init'
+static void _testSlowReplies()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    simulator.Config().pageUs = 30000;
+    EmNextion display(simulator, 50);
+    EM_NEX_CHECK(display.Init());
+
+    // Fast feedbacks don't shorten page change deadline
+    for (int32_t i = 0; i < 50; i++) {
+        EM_NEX_CHECK(display.SetNumElementValue("main", "n1", i));
+    }
+    EM_NEX_CHECK(display.SetCurPage(1));
+    EM_NEX_CHECK(1 == simulator.CurPage());
+    EM_NEX_CHECK(display.SetCurPage("main"));
+    _checkInSync(display, simulator);
+
+    // Slower feedback within 'TimeoutMs'
+    simulator.Config().processingUs = 30000;
+    EM_NEX_CHECK(display.SetNumElementValue("main", "n1", 1));
+    simulator.Config().processingUs = 300;
+
+    // Page change reply comes too late
+    simulator.Config().pageUs = 150000;
+    EM_NEX_CHECK(!display.SetCurPage("main"));
+    simulator.Config().pageUs = 0;
+    // Late reply is received before next command
+    EmTimeout settle(150);
+    while (!settle.IsElapsed(false)) {
+    }
+    _checkInSync(display, simulator);
+}
+
+static void _onChange(void* context)
+{
+    (*static_cast<uint32_t*>(context))++;
+}
+
+// Unknown current page is queried without blocking 'Poll', page
+// values subscriptions wait for its reply
+static void _testSubscriptionPageQuery()
+{
+    _setupDisplay(pageSimulator);
+    pageSimulator.SetNumber("main.n2.val", 42);
+    EM_NEX_CHECK(pageDisplay.Init());
+    uint32_t changes = 0;
+    EmNexSubscription subscription(numberOf, 20, 0, _onChange, &changes);
+
+    // Not current page values are not read
+    EM_NEX_CHECK(pageDisplay.SetCurPage(1));
+    pageDisplay.Subscribe(subscription);
+    pageDisplay.Poll();
+    EM_NEX_CHECK(0 == pageDisplay.PendingCount());
+
+    // Page id is unknown after a change by name
+    EM_NEX_CHECK(pageDisplay.SetCurPage("main"));
+    // Subscription is due
+    EmTimeout period(30);
+    while (!period.IsElapsed(false)) {
+    }
+    pageSimulator.Config().processingUs = 50000;
+    pageSimulator.ClearLog();
+    uint32_t startMs = millis();
+    pageDisplay.Poll();
+    EM_NEX_CHECK(millis() - startMs < 20);
+    EM_NEX_CHECK(1 == pageDisplay.PendingCount());
+    pageDisplay.Poll();
+    EM_NEX_CHECK(1 == pageDisplay.PendingCount());
+    pageSimulator.Config().processingUs = 300;
+
+    EmTimeout timeout(500);
+    while (0 == changes && !timeout.IsElapsed(false)) {
+        pageDisplay.Poll();
+    }
+    EM_NEX_CHECK(1 == changes);
+    EM_NEX_CHECK(42 == numberValue);
+    EM_NEX_CHECK(!pageSimulator.Log().empty() && "sendme" == pageSimulator.Log().front());
+    uint8_t pageId = 1;
+    EM_NEX_CHECK(pageDisplay.GetCurPage(pageId) && 0 == pageId);
+    pageDisplay.Unsubscribe(subscription);
+    pageDisplay.WaitPending();
+}
+
+// 'Poll' doesn't try to reconnect a lost link
+static void _testSubscriptionLinkLost()
+{
+    _setupDisplay(pageSimulator);
+    pageSimulator.SetNumber("main.n2.val", 7);
+    EM_NEX_CHECK(pageDisplay.Init());
+    EM_NEX_CHECK(mainPage.SetAsCurrent());
+    uint32_t changes = 0;
+    EmNexSubscription subscription(numberOf, 10, 0, _onChange, &changes);
+    pageDisplay.Subscribe(subscription);
+
+    // Garbled line: display doesn't answer
+    pageSimulator.SetHostBaud(9600);
+    int32_t value = 0;
+    EM_NEX_CHECK(EmGetValueResult::failed == pageDisplay.GetNumElementValue("main", "n0", value));
+    EM_NEX_CHECK(!pageDisplay.IsInit());
+    uint32_t maxMs = 0;
+    EmTimeout timeout(100);
+    while (!timeout.IsElapsed(false)) {
+        uint32_t startMs = millis();
+        pageDisplay.Poll();
+        if (millis() - startMs > maxMs) {
+            maxMs = millis() - startMs;
+        }
+    }
+    EM_NEX_CHECK(maxMs < 10);
+    EM_NEX_CHECK(!pageDisplay.IsInit());
+
+    // Reads resume once application initializes the link again
+    pageSimulator.SetHostBaud(0);
+    EmTimeout reconnect(500);
+    while (!pageDisplay.Init() && !reconnect.IsElapsed(false)) {
+    }
+    EM_NEX_CHECK(pageDisplay.IsInit());
+    numberValue = 0;
+    timeout.Restart();
+    while (0 == changes && !timeout.IsElapsed(false)) {
+        pageDisplay.Poll();
+    }
+    EM_NEX_CHECK(7 == numberValue);
+    pageDisplay.Unsubscribe(subscription);
+    pageDisplay.WaitPending();
+}
+
+// 'Init' recovers at once from a garbled line (display keeps 
+// a partial command)
+static void _testInitAfterGarbledLine()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    EmNextion display(simulator, 50);
+    EM_NEX_CHECK(display.Init());
+
+    simulator.SetHostBaud(9600);
+    int32_t value = 0;
+    EM_NEX_CHECK(EmGetValueResult::failed == display.GetNumElementValue("main", "n0", value));
+    EM_NEX_CHECK(!display.IsInit());
+    simulator.SetHostBaud(0);
+    EM_NEX_CHECK(display.Init());
+    _checkInSync(display, simulator);
+}
+
+#ifdef EM_NEX_STATS
+// Pipelined commands latency is measured from their own send time
+static void _testPipelinedLatencyStats()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    EmNextion display(simulator, 100);
+    EM_NEX_CHECK(display.Init());
+    simulator.Config().processingUs = 15000;
+
+    display.SetPipelined(true);
+    display.ResetStats();
+    for (int32_t i = 0; i < EM_NEX_MAX_PENDING; i++) {
+        EM_NEX_CHECK(display.SetNumElementValue("main", "n0", i));
+    }
+    EM_NEX_CHECK(display.WaitPending());
+    display.SetPipelined(false);
+    const uint16_t* latency = display.Stats().cmd[CMD_SET].latency;
+    // Every reply took at least the processing time (i.e. no one 
+    // under 10 ms bucket bound), the last one waited for previous 
+    // commands execution too
+    static const uint16_t bounds[] = { EM_NEX_STATS_LAT_BOUNDS };
+    uint32_t lastMs = EM_NEX_MAX_PENDING*15 + 2;
+    int lastBucket = 0;
+    while (lastBucket < EM_NEX_STATS_LAT_BUCKETS-1 && lastMs >= bounds[lastBucket]) {
+        lastBucket++;
+    }
+    uint32_t count = 0;
+    for (int i = 0; i < EM_NEX_STATS_LAT_BUCKETS; i++) {
+        EM_NEX_CHECK(i >= 4 || 0 == latency[i]);
+        EM_NEX_CHECK(i <= lastBucket || 0 == latency[i]);
+        count += latency[i];
+    }
+    EM_NEX_CHECK(EM_NEX_MAX_PENDING == count);
+    EM_NEX_CHECK(0 != latency[lastBucket]);
+}
+#endif
+
+class EventCounter: public EmNexEventListener {
+public:
+    EventCounter()
+     : touches(0) {}
+
+    virtual void OnNexEvent(const EmNexEvent& event) override {
+        touches += (EVT_TOUCH == event.code) ? 1 : 0;
+    }
+
+    uint32_t touches;
+};
+
+// Events received while waiting are queued (newest lost on overflow)
+// and dispatched by 'Poll'
+static void _testEventQueueOverflow()
+{
+    EmNexSimulator simulator;
+    _setupDisplay(simulator);
+    EmNextion display(simulator, 100);
+    EventCounter counter;
+    display.AddListener(counter);
+    EM_NEX_CHECK(display.Init());
+
+    for (uint8_t i = 0; i < EM_NEX_MAX_EVENTS + 2; i++) {
+        simulator.Touch(1, true);
+    }
+    int32_t value = 0;
+    EM_NEX_CHECK(EmGetValueResult::failed != display.GetNumElementValue("main", "n0", value));
+    EM_NEX_CHECK(0 == counter.touches);
+    display.Poll();
+    EM_NEX_CHECK(EM_NEX_MAX_EVENTS == counter.touches);
+
+    // Queue is available again
+    simulator.Touch(1, false);
+    EmTimeout timeout(100);
+    while (EM_NEX_MAX_EVENTS == counter.touches && !timeout.IsElapsed(false)) {
+        display.Poll();
+    }
+    EM_NEX_CHECK(EM_NEX_MAX_EVENTS + 1 == counter.touches);
+    display.RemoveListener(counter);
+}
+
+struct EmNexTest {
+    const char* name;
+    void (*run)();
+};
+
+static const EmNexTest TESTS[] = {
+    { "fifo_matching", _testFifoMatching },
+    { "batch_single_write", _testBatchSingleWrite },
+    { "batch_behind_pending", _testBatchBehindPending },
+    { "failures_only_batch", _testFailuresOnlyBatch },
+    { "failures_only_batch_get", _testFailuresOnlyBatchGet },
+    { "failures_only_batch_slow_line", _testFailuresOnlyBatchSlowLine },
+    { "resync_garbage", _testResyncGarbage },
+    { "resync_drops", _testResyncDrops },
+    { "console_trim", _testConsoleTrim },
+    { "gauge_gated_async", _testGaugeGatedAsync },
+    { "text_shadow", _testTextShadow },
+    { "waveform_ring", _testWaveformRing },
+    { "async_callbacks", _testAsyncCallbacks },
+    { "blocking_get_in_callback", _testBlockingGetInCallback },
+    { "slow_replies", _testSlowReplies },
+    { "init_after_garbled_line", _testInitAfterGarbledLine },
+    { "subscription_page_query", _testSubscriptionPageQuery },
+    { "subscription_link_lost", _testSubscriptionLinkLost },
+#ifdef EM_NEX_STATS
+    { "pipelined_latency_stats", _testPipelinedLatencyStats },
+#endif
+    { "event_queue_overflow", _testEventQueueOverflow },
+};
+
+int main(int argc, char* argv[])
+{
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(TESTS)/sizeof(TESTS[0]); i++) {
+        if (argc > 1 && 0 != strcmp(argv[1], TESTS[i].name)) {
+            continue;
+        }
+        uint32_t failures = s_failures;
+        TESTS[i].run();
+        bool passed = (failures == s_failures);
+        printf("%s %s\n", passed ? "PASS" : "FAIL", TESTS[i].name);
+        failed += passed ? 0 : 1;
+    }
+    printf("%lu checks, %d failed tests\n",
+           static_cast<unsigned long>(s_checks),
+           failed);
+    return failed;
+}
@@ -7,6 +7,22 @@
 #include "em_log.h"
 #include "em_com_device.h"
 #include "em_sync_value.h"
+#include "em_timeout.h"
+
+// Waveform ring buffers indexes (see 'EmNexWaveform') are 'std::atomic' 
+// unless EM_NEX_WAVEFORM_ATOMIC is 0 (default on AVR: no <atomic>, 
+// volatile 8 bits indexes are enough on single core MCUs)
+#ifndef EM_NEX_WAVEFORM_ATOMIC
+#ifdef __AVR__
+#define EM_NEX_WAVEFORM_ATOMIC 0
+#else
+#define EM_NEX_WAVEFORM_ATOMIC 1
+#endif
+#endif
+
+#if EM_NEX_WAVEFORM_ATOMIC
+#include <atomic>
+#endif
 
 // Nextion defined result codes
 enum EmNextionRet: uint8_t {
@@ -19,11 +35,188 @@ enum EmNextionRet: uint8_t {
     INVALID_PAGE_ID = 0x03,
     INVALID_PICTURE_ID = 0x04,
     INVALID_FONT_ID = 0x05,
+    INVALID_FILE_OPERATION = 0x06,
+    INVALID_CRC = 0x09,
     INVALID_BAUD = 0x11,
+    INVALID_WAVEFORM = 0x12,        // invalid waveform id or channel
     INVALID_VARIABLE = 0x1A,
-    INVALID_OPERATION = 0x1B
+    INVALID_OPERATION = 0x1B,
+    ASSIGNMENT_FAILED = 0x1C,
+    EEPROM_FAILED = 0x1D,
+    INVALID_PARAMS_QUANTITY = 0x1E,
+    IO_FAILED = 0x1F,
+    INVALID_ESCAPE_CHAR = 0x20,
+    VARIABLE_NAME_TOO_LONG = 0x23,
+    SERIAL_BUFFER_OVERFLOW = 0x24,
+    // Transparent data transfer ('addt')
+    ACK_TRANSPARENT_DONE = 0xFD,
+    ACK_TRANSPARENT_READY = 0xFE,
+    // Library defined code (0xFF is never sent as a return code 
+    // since it is the frame terminator)
+    NO_FEEDBACK = 0xFF
+};
+
+// Nextion unsolicited frame codes
+enum EmNexEventCode: uint8_t {
+    EVT_STARTUP = 0x00,
+    EVT_TOUCH = 0x65,
+    EVT_PAGE = 0x66,
+    EVT_TOUCH_XY = 0x67,
+    EVT_SLEEP_TOUCH_XY = 0x68,
+    EVT_SLEEP = 0x86,
+    EVT_WAKE_UP = 0x87,
+    EVT_READY = 0x88,
+    EVT_SD_UPGRADE = 0x89
+};
+
+// A display event (only 'code' related fields are set)
+struct EmNexEvent {
+    EmNexEventCode code;
+    uint8_t pageId;       // EVT_TOUCH, EVT_PAGE
+    uint8_t componentId;  // EVT_TOUCH
+    bool pressed;         // EVT_TOUCH, EVT_TOUCH_XY, EVT_SLEEP_TOUCH_XY
+    uint16_t x;           // EVT_TOUCH_XY, EVT_SLEEP_TOUCH_XY
+    uint16_t y;           // EVT_TOUCH_XY, EVT_SLEEP_TOUCH_XY
+};
+
+// Display events listener (see 'EmNextion::AddListener')
+class EmNexEventListener {
+public:
+    EmNexEventListener()
+     : m_nextListener(NULL) {}
+
+    virtual void OnNexEvent(const EmNexEvent& event) = 0;
+
+private:
+    friend class EmNextion;
+    EmNexEventListener* m_nextListener;
 };
 
+// Build configuration
+//
+// NOTE: EM_NEX_MAX_EVENTS, EM_NEX_MAX_PENDING, EM_NEX_TRACE_SIZE and 
+//       EM_NEX_STATS change 'EmNextion' class layout, they must be 
+//       global build flags (e.g. PlatformIO 'build_flags' or Arduino 
+//       'platform.local.txt' compiler.cpp.extra_flags). A '#define' in 
+//       the sketch does not reach library sources, sketch and library 
+//       would then disagree on the class layout (ODR violation, memory 
+//       corruption at run time)
+
+// Max number of display events waiting to be dispatched by 'Poll'
+#ifndef EM_NEX_MAX_EVENTS
+#define EM_NEX_MAX_EVENTS 4
+#endif
+
+// Max number of pipelined commands waiting for display feedback
+//
+// NOTE: each pending command costs about 18 bytes of RAM on AVR 
+//       (about 24 on 32 bits MCUs). A deeper queue lets more commands 
+//       (and subscriptions, see 'EmNextion::Subscribe') be in flight 
+//       on slow links at the cost of RAM; methods wait for the oldest 
+//       reply once the queue is full
+#ifndef EM_NEX_MAX_PENDING
+#define EM_NEX_MAX_PENDING 4
+#endif
+
+// Debug logs (see 'EmLogLevel::debug') are compiled in unless 
+// EM_NEX_DEBUG_LOG is 0 (e.g. saves formatting arguments evaluation 
+// and flash when logs are not needed)
+#ifndef EM_NEX_DEBUG_LOG
+#define EM_NEX_DEBUG_LOG 1
+#endif
+
+// Number of link activity records kept by the binary trace (see 
+// 'EmNextion::ReadTrace'), 0 to disable it (global build flag, see above)
+#ifndef EM_NEX_TRACE_SIZE
+#define EM_NEX_TRACE_SIZE 0
+#endif
+
+// Trace record kinds
+enum EmNexTraceKind: uint8_t {
+    TRACE_TX,         // 'arg': bytes written
+    TRACE_CMD,        // 'code': expected reply code, 'arg': command tag
+    TRACE_REPLY,      // 'code': reply code (or NO_FEEDBACK), 'arg': latency ms
+    TRACE_TIMEOUT,    // 'code': expected reply code
+    TRACE_LINK_LOST,
+    TRACE_EVENT,      // 'code': display event code
+    TRACE_RESYNC      // 'code': code of the corrupted frame
+};
+
+struct EmNexTraceRecord {
+    uint16_t timeMs;  // 'millis' lowest 16 bits
+    EmNexTraceKind kind;
+    uint8_t code;
+    uint16_t arg;
+};
+
+// Link statistics (see 'EmNextion::Stats') are compiled in only if 
+// EM_NEX_STATS is defined (as a global build flag, see above)
+#ifdef EM_NEX_STATS
+
+// Command types statistics are kept for
+enum EmNexCmdType: uint8_t {
+    CMD_GET,
+    CMD_SET,
+    CMD_PAGE,   // 'page' and 'sendme'
+    CMD_VIS,
+    CMD_CLICK,
+    CMD_OTHER,  // e.g. 'bkcmd', 'ref_stop', 'addt'
+    CMD_TYPES
+};
+
+// Replies latency histogram: bucket upper bounds (ms), the last 
+// bucket counts slower replies
+#define EM_NEX_STATS_LAT_BOUNDS 1, 2, 5, 10, 20, 50, 100, 200
+#define EM_NEX_STATS_LAT_BUCKETS 9
+
+// Error replies counters (see 'EmNexStatsErrorIndex')
+#define EM_NEX_STATS_ERRORS 9
+
+struct EmNexCmdStats {
+    uint32_t sent;
+    uint32_t txBytes;
+    uint32_t rxBytes;
+    uint16_t timeouts;
+    uint16_t errors[EM_NEX_STATS_ERRORS];
+    uint16_t latency[EM_NEX_STATS_LAT_BUCKETS];
+};
+
+struct EmNexStats {
+    EmNexCmdStats cmd[CMD_TYPES];
+    uint32_t eventBytes;  // bytes received while no command was pending
+    uint16_t initResets;  // times the link was lost (see 'IsInit')
+    uint16_t badFrames;   // corrupted frames parsed again
+};
+
+// 'EmNexCmdStats::errors' index of a display reply code: INVALID_CMD, 
+// INVALID_COMPONENT_ID, INVALID_PAGE_ID, INVALID_PICTURE_ID, 
+// INVALID_FONT_ID, INVALID_BAUD, INVALID_VARIABLE, INVALID_OPERATION 
+// and finally any other unexpected reply
+inline uint8_t EmNexStatsErrorIndex(uint8_t code) {
+    static const uint8_t codes[EM_NEX_STATS_ERRORS-1] = {
+        INVALID_CMD, INVALID_COMPONENT_ID, INVALID_PAGE_ID, INVALID_PICTURE_ID,
+        INVALID_FONT_ID, INVALID_BAUD, INVALID_VARIABLE, INVALID_OPERATION
+    };
+    for (uint8_t i = 0; i < sizeof(codes); i++) {
+        if (codes[i] == code) {
+            return i;
+        }
+    }
+    return EM_NEX_STATS_ERRORS-1;
+}
+
+#endif
+
+// Pipelined command completion callback.
+//
+// NOTES:
+//  1. 'cmdTag' is the value returned by 'LastCmdTag' after sending the command
+//  2. 'ret' is ACK_CMD_SUCCEED, the display error code or NO_FEEDBACK 
+//     if display did not answer in time
+typedef void (*EmNexCmdCallback)(uint16_t cmdTag, 
+                                 EmNextionRet ret, 
+                                 void* context);
+
 // Color Code Constants
 enum EmNexColor: uint16_t {
     BLACK = 0,
@@ -52,6 +245,135 @@ inline void FromColor565(uint16_t color565, uint8_t& red, uint8_t& green, uint8_
     blue = (color565 & 0x1F) << 3;     // ............bbbbb -> bbbbb000
 }
 
+// Asynchronous method completion callback.
+//
+// NOTE: 'result' is 'failed' or a 'succeed' value, for get methods 
+//       'succeedNotEqualValue' means that the received value changed
+typedef void (*EmNexAsyncCallback)(EmGetValueResult result, 
+                                   void* context);
+
+// Max length of commands assembled by display methods 
+// (longer texts are written apart)
+#ifndef EM_NEX_MAX_CMD_LEN
+#define EM_NEX_MAX_CMD_LEN 64
+#endif
+
+// Nextion command builder: the command and its terminators are 
+// assembled into a buffer so that they are sent with one single write.
+//
+// NOTES:
+//  1. use 'EmNexCmd' template to allocate the buffer
+//  2. a command exceeding buffer size is not valid
+class EmNexCmdBuf {
+public:
+    static const char TERMINATORS[];
+
+    EmNexCmdBuf& Add(const char* str);
+    EmNexCmdBuf& Add(char c);
+    EmNexCmdBuf& AddNumber(int32_t value);
+
+    // Shrink command to 'len' bytes (i.e. cut what has been added after)
+    void Resize(uint16_t len);
+
+    // Append terminators (called before sending)
+    void End();
+
+    bool IsValid() const {
+        return !m_overflow;
+    }
+
+    const char* Data() const {
+        return m_buf;
+    }
+
+    uint16_t Len() const {
+        return m_len;
+    }
+
+protected:
+    EmNexCmdBuf(char* buf, uint16_t size)
+     : m_buf(buf),
+       m_size(size),
+       m_len(0),
+       m_overflow(false),
+       m_ended(false) {
+        m_buf[0] = 0;
+    }
+
+private:
+    char* m_buf;
+    const uint16_t m_size;
+    uint16_t m_len;
+    bool m_overflow;
+    bool m_ended;
+};
+
+template<uint16_t max_len>
+class EmNexCmd: public EmNexCmdBuf {
+public:
+    EmNexCmd()
+     : EmNexCmdBuf(m_cmd, max_len) {}
+
+private:
+    // Command + terminators
+    char m_cmd[max_len+3];
+};
+
+// Text written to display in chunks (e.g. a long log pane) without 
+// assembling it into one buffer
+class EmNexTextSource {
+public:
+    // Next chunk of text: its length is returned, 0 if text is over
+    //
+    // NOTE: chunk memory must be valid until next call
+    virtual uint16_t NextChunk(const char*& chunk) = 0;
+};
+
+// Single string source
+class EmNexStringSource: public EmNexTextSource {
+public:
+    EmNexStringSource(const char* text)
+     : m_text(text) {}
+
+    virtual uint16_t NextChunk(const char*& chunk) override {
+        chunk = m_text;
+        uint16_t len = (NULL != m_text) ? strlen(m_text) : 0;
+        m_text = NULL;
+        return len;
+    }
+
+private:
+    const char* m_text;
+};
+
+// Text read from display received character by character (i.e. 
+// texts of any length without an intermediate buffer)
+class EmNexTextSink {
+public:
+    // Received character at 'pos', returns true if sink content changed
+    virtual bool Put(uint16_t pos, char c) = 0;
+
+    // Text is over ('len' characters), returns true if sink 
+    // content changed (e.g. previous text was longer)
+    virtual bool End(uint16_t len) = 0;
+
+    // Text could not be received (some characters might have been put)
+    virtual void Abort() {}
+};
+
+class EmNexSubscription;
+
+// Called while blocking methods are waiting for display replies
+typedef void (*EmNexIdleCallback)(void* context);
+
+// Sets host serial line bauds (e.g. calls 'Serial.begin(baud)')
+typedef bool (*EmNexSetBaudCallback)(uint32_t baud, void* context);
+
+// Lower bound of timeouts rescaled to serial line bauds
+#ifndef EM_NEX_MIN_TIMEOUT_MS
+#define EM_NEX_MIN_TIMEOUT_MS 10
+#endif
+
 // The main nextion display handling class
 class EmNextion: public EmLog {
 public:
@@ -65,11 +387,99 @@ public:
         return m_IsInit;
     }
 
+    // Reply code of the last completed command: ACK_CMD_SUCCEED if it 
+    // succeeded, else the display error code (e.g. INVALID_VARIABLE), 
+    // the unexpected reply code or NO_FEEDBACK if display did not answer.
+    //
+    // NOTE: display errors complete commands as soon as they are 
+    //       received (i.e. no timeout wait)
+    EmNextionRet LastError() const {
+        return m_LastError;
+    }
+
+    // Probe display at standard bauds ('setBaud' reconfigures host 
+    // serial line), then move both sides to the highest baud up to 
+    // 'maxBaud' and initialize display (see 'Init').
+    //
+    // NOTES:
+    //  1. constructor 'timeoutMs' is meant for 9600 bauds, timeout 
+    //     is rescaled to the negotiated baud (see 'TimeoutMs')
+    //  2. display resets to its 'bauds' value at power up
+    bool Negotiate(EmNexSetBaudCallback setBaud, 
+                   void* context=NULL,
+                   uint32_t maxBaud=921600) const;
+
+    // Negotiated bauds (0 if 'Negotiate' was never called)
+    uint32_t Baud() const {
+        return m_Baud;
+    }
+
+    uint32_t TimeoutMs() const {
+        return m_TimeoutMs;
+    }
+
+    // Replies deadline is adapted to the latency measured for each 
+    // command class (feedback, number, string, page) plus its jitter 
+    // margin and the expected reply transfer time, it is never shorter 
+    // than 'TimeoutMs' (i.e. estimates only extend it, e.g. long texts 
+    // at low bauds).
+    //
+    // NOTES:
+    //  1. page class includes 'page', 'rest', 'sendme' and 'ref_star' 
+    //     commands (i.e. slow feedbacks, display redraws or resets)
+    //  2. estimates are reset by 'Negotiate' (i.e. bauds change)
+    void ResetLatency() const {
+        m_LatValid = 0;
+    }
+
+#if EM_NEX_TRACE_SIZE
+    // Move the oldest (up to 'maxCount') trace records to 'records', 
+    // returns the number of records moved.
+    //
+    // NOTE: when the trace is full oldest records are overwritten
+    uint8_t ReadTrace(EmNexTraceRecord* records, 
+                      uint8_t maxCount) const;
+#endif
+
+#ifdef EM_NEX_STATS
+    // Link statistics since last 'ResetStats' call: per command type 
+    // sent commands, bytes, error replies, timeouts and replies 
+    // latency histogram (i.e. time from send to reply).
+    //
+    // NOTES:
+    //  1. bytes received are charged to the oldest pending command
+    //  2. batch commands feedbacks are charged to the type of the 
+    //     last recorded one
+    const EmNexStats& Stats() const {
+        return m_Stats;
+    }
+
+    void ResetStats() const {
+        memset(&m_Stats, 0, sizeof(m_Stats));
+    }
+#endif
+
+    // Current page is tracked locally: it is updated by 'SetCurPage' 
+    // and by page id frames sent by display (i.e. touch events and 
+    // 'sendme' replies) processed by 'Poll'.
+    //
+    // NOTES:
+    //  1. display is queried only if current page is unknown
+    //  2. add 'sendme' to pages 'preinit' event to track page changes
+    //     not requested by this library (e.g. buttons changing page)
     bool IsCurPage(uint8_t pageId) const;
     bool GetCurPage(uint8_t& pageId) const;
+
+    // Query current page to display
+    bool RefreshCurPage(uint8_t& pageId) const;
+
+
     bool SetCurPage(uint8_t pageId) const;
     bool SetCurPage(const char* pageName) const;
 
+    // NOTE: element methods 'pageName' can be NULL, 'elementName' is then
+    //       a current page element or a full path (e.g. "p_main.t_caption"
+    //       or the shorter component IDs path "p[0].b[3]", see 'EmNexElementName')
     EmGetValueResult GetNumElementValue(const char* pageName, 
                                         const char* elementName, 
                                         int32_t& val) const;
@@ -85,10 +495,45 @@ public:
                              const char* elementName, 
                              const char* txt) const;
 
+    // Append 'txt' to element text ('txt+=')
+    bool AppendTextElementValue(const char* pageName, 
+                                const char* elementName, 
+                                const char* txt) const;
+
+    // Keep 'len' characters of element text from 'start' ('substr')
+    bool SubTextElementValue(const char* pageName, 
+                             const char* elementName, 
+                             uint16_t start,
+                             uint16_t len) const;
+
+    // Add a value to a waveform channel ('add')
+    bool AddWaveformValue(uint8_t componentId, 
+                          uint8_t channel, 
+                          uint8_t value) const;
+
+    // Add 'len' values to a waveform channel with one transparent 
+    // data transfer ('addt'), i.e. command waits display ready 
+    // frame, data is sent raw and display confirms its completion
+    //
+    // NOTE: waveform must be in current page
+    bool AddWaveformData(uint8_t componentId, 
+                         uint8_t channel, 
+                         const uint8_t* data,
+                         uint16_t len) const;
+
+    // Streamed texts (no length limit, no intermediate copy)
+    EmGetValueResult GetTextElementValue(const char* pageName, 
+                                         const char* elementName, 
+                                         EmNexTextSink& sink) const;
+    bool SetTextElementValue(const char* pageName, 
+                             const char* elementName, 
+                             EmNexTextSource& source) const;
+
     // Set element visibility.
     //
     // NOTES:
-    //  1. element should be in current page
+    //  1. element should be in current page ('elementName' 
+    //     can be the component ID, e.g. "3")
     //  2. visibility attribute is reset if page is changed 
     //     or display recovers from screen saver
     bool SetVisible(const char* elementName, 
@@ -194,6 +639,239 @@ public:
                const char* elementName, 
                bool pressed = true) const;               
 
+    // Pipelined mode: set commands are sent back-to-back without waiting
+    // for display feedback. Feedbacks (enabled by 'bkcmd=3') are matched to 
+    // sent commands in FIFO order and reported through 'callback'. 
+    //
+    // NOTES:
+    //  1. setters return true once the command has been sent
+    //  2. get commands (and any other command waiting for a reply) 
+    //     wait for all pending feedbacks before reading their own reply 
+    //  3. disabling pipelined mode waits for all pending feedbacks
+    void SetPipelined(bool pipelined, 
+                      EmNexCmdCallback callback=NULL, 
+                      void* context=NULL) const;
+
+    bool IsPipelined() const {
+        return m_Pipelined;
+    }
+
+    // The tag of the last pipelined command
+    uint16_t LastCmdTag() const {
+        return m_CmdTag;
+    }
+
+    // Number of pipelined commands still waiting for feedback
+    uint8_t PendingCount() const {
+        return m_PendingCount;
+    }
+
+    // Number of pipelined commands failed since last 'ResetFailedCount' call
+    uint16_t FailedCount() const {
+        return m_FailedCount;
+    }
+
+    void ResetFailedCount() const {
+        m_FailedCount = 0;
+    }
+
+    // Asynchronous methods: the command is sent and the method returns 
+    // immediately, 'callback' is called by 'Poll' once the display replied 
+    // (or failed). Received values are stored into the given variables.
+    //
+    // NOTES:
+    //  1. variables and text buffers must exist until completion
+    //  2. false is returned (and callback is not called) if command 
+    //     could not be sent
+    //  3. methods wait only if EM_NEX_MAX_PENDING commands are pending
+    //  4. with no callback the pipelined callback (if any) is called
+    //  5. callbacks are not called within 'failuresOnly' batches
+    //  6. replies received while a blocking method is waiting call 
+    //     their callback too; callbacks may call blocking methods
+    bool GetNumElementValueAsync(const char* pageName, 
+                                 const char* elementName, 
+                                 int32_t& val,
+                                 EmNexAsyncCallback callback,
+                                 void* context=NULL) const;
+    bool GetTextElementValueAsync(const char* pageName, 
+                                  const char* elementName, 
+                                  char* txt,
+                                  uint16_t bufLen,
+                                  EmNexAsyncCallback callback,
+                                  void* context=NULL) const;
+    bool GetTextElementValueAsync(const char* pageName, 
+                                  const char* elementName, 
+                                  EmNexTextSink& sink,
+                                  EmNexAsyncCallback callback,
+                                  void* context=NULL) const;
+    bool GetPictureAsync(const char* pageName, 
+                         const char* elementName, 
+                         uint8_t& picId,
+                         EmNexAsyncCallback callback,
+                         void* context=NULL) const;
+    bool GetBkColorAsync(const char* pageName, 
+                         const char* elementName, 
+                         uint16_t& color565,
+                         EmNexAsyncCallback callback,
+                         void* context=NULL) const {
+        return _getColorAsync(pageName, elementName, "bco", color565, callback, context);
+    }
+    bool GetFontColorAsync(const char* pageName, 
+                           const char* elementName, 
+                           uint16_t& color565,
+                           EmNexAsyncCallback callback,
+                           void* context=NULL) const {
+        return _getColorAsync(pageName, elementName, "pco", color565, callback, context);
+    }
+
+    bool SetNumElementValueAsync(const char* pageName, 
+                                 const char* elementName, 
+                                 int32_t val,
+                                 EmNexAsyncCallback callback=NULL,
+                                 void* context=NULL) const;
+    bool SetTextElementValueAsync(const char* pageName, 
+                                  const char* elementName, 
+                                  const char* txt,
+                                  EmNexAsyncCallback callback=NULL,
+                                  void* context=NULL) const;
+    bool SetTextElementValueAsync(const char* pageName, 
+                                  const char* elementName, 
+                                  EmNexTextSource& source,
+                                  EmNexAsyncCallback callback=NULL,
+                                  void* context=NULL) const;
+    bool SetPictureAsync(const char* pageName, 
+                         const char* elementName, 
+                         uint8_t picId,
+                         EmNexAsyncCallback callback=NULL,
+                         void* context=NULL) const;
+    bool SetBkColorAsync(const char* pageName, 
+                         const char* elementName, 
+                         uint16_t color565,
+                         EmNexAsyncCallback callback=NULL,
+                         void* context=NULL) const {
+        return _setColorAsync(pageName, elementName, "bco", color565, callback, context);
+    }
+    bool SetFontColorAsync(const char* pageName, 
+                           const char* elementName, 
+                           uint16_t color565,
+                           EmNexAsyncCallback callback=NULL,
+                           void* context=NULL) const {
+        return _setColorAsync(pageName, elementName, "pco", color565, callback, context);
+    }
+    bool SetVisibleAsync(uint8_t pageId, 
+                         const char* elementName, 
+                         bool visible,
+                         EmNexAsyncCallback callback=NULL,
+                         void* context=NULL) const;
+    bool ClickAsync(uint8_t pageId, 
+                    const char* elementName, 
+                    bool pressed,
+                    EmNexAsyncCallback callback=NULL,
+                    void* context=NULL) const;
+
+    // Process received bytes without blocking: frames are parsed 
+    // incrementally, pipelined feedbacks are matched, display 
+    // events are dispatched to listeners and subscribed values 
+    // are read (see 'Subscribe').
+    //
+    // NOTE: events received while blocking methods are waiting are 
+    //       queued (see EM_NEX_MAX_EVENTS) and dispatched by next call
+    void Poll() const;
+
+    // Subscribed values are read by 'Poll' every subscription period 
+    // (if their page is current), most urgent and highest priority 
+    // first, and subscription callback is called when they change.
+    //
+    // NOTES:
+    //  1. reads are spread over time within the budget set by 
+    //     'SetReadBudget' (commands and replies bytes per second)
+    //  2. if current page is unknown 'Poll' queries it without waiting
+    //     the reply, page values reads are delayed until it comes
+    //  3. values are not read while the link is lost (i.e. 'IsInit' 
+    //     is false), call 'Init' to reconnect
+    void Subscribe(EmNexSubscription& subscription) const;
+    void Unsubscribe(EmNexSubscription& subscription) const;
+
+    // Subscriptions reads bandwidth (0 = no limit)
+    void SetReadBudget(uint16_t bytesPerSecond) const;
+
+    // Display events listeners (called by 'Poll').
+    //
+    // NOTES:
+    //  1. listeners can call any method (but 'Poll')
+    //  2. touch events are sent by display only if "Send Component ID" 
+    //     is checked in the component touch event
+    //  3. startup and ready events reset display initialization
+    void AddListener(EmNexEventListener& listener) const;
+    void RemoveListener(EmNexEventListener& listener) const;
+
+    // Let the program run other tasks while a blocking method is waiting 
+    // for display reply (e.g. get values).
+    //
+    // NOTE: the callback must not use this display object
+    void SetIdleCallback(EmNexIdleCallback callback, 
+                         void* context=NULL) const;
+
+    // Wait until all pipelined commands got their feedback.
+    // Returns false if any of them failed since last 'ResetFailedCount' call.
+    bool WaitPending() const;
+
+    // Batch mode: commands sent in between 'BeginBatch' and 'CommitBatch' 
+    // are recorded into 'buf' and sent with one single serial write. 
+    // If 'failuresOnly' is true the batch runs with 'bkcmd=2' so that 
+    // the display acknowledges failed commands only.
+    //
+    // NOTES:
+    //  1. 'buf' is written when full (i.e. batch size is not limited by 'size')
+    //  2. get commands (and any other command waiting for a reply) 
+    //     write the recorded commands before waiting their own reply. 
+    //     In 'failuresOnly' batches they end 'bkcmd=2' first (i.e. 
+    //     recorded commands failures are waited) and next commands 
+    //     of the batch get success feedback too
+    //  3. 'CommitBatch' returns false if any batched command failed 
+    //     (in pipelined mode failures are reported by callback)
+    //  4. recorded commands feedbacks are queued when the batch is 
+    //     written (i.e. pending commands limit doesn't split it)
+    //  5. pipelined commands still waiting for feedback are not 
+    //     waited, their failures are not batch failures
+    //  6. use 'EmNexBatch' class for a scoped batch
+    bool BeginBatch(char* buf, 
+                    uint16_t size, 
+                    bool failuresOnly=false) const;
+    bool CommitBatch() const;
+
+    bool IsBatch() const {
+        return NULL != m_BatchBuf;
+    }
+
+    // Suspend waveforms refresh ('ref_stop'): data added meanwhile 
+    // (see 'AddWaveformValue'/'AddWaveformData') is drawn at once by 
+    // 'StartRefresh' ('ref_star').
+    //
+    // NOTES:
+    //  1. other elements are redrawn as they are updated anyway 
+    //     (use 'EmNexBatch' to send many updates with one write)
+    //  2. calls can be nested: refresh restarts at the outermost 
+    //     'StartRefresh' call
+    //  3. if 'ref_star' fails it is sent again at next 'Init'
+    //  4. use 'EmNexRefreshLock' class for a scoped suspension
+    bool StopRefresh() const;
+    bool StartRefresh() const;
+
+    bool IsRefreshStopped() const {
+        return 0 != m_RefreshStops;
+    }
+
+    // Element shadow values (see 'EmNexShadow') are valid within the 
+    // same generation only. A new generation starts on page change, 
+    // on command failures and when the display has to be initialized 
+    // again (i.e. when display resets elements attributes).
+    uint16_t ShadowGen() const {
+        return m_ShadowGen;
+    }
+
+    void InvalidateShadows() const;
+
 protected:
     bool _sendGetCmd(const char* pageName, 
                      const char* elementName, 
@@ -206,21 +884,28 @@ protected:
                      const char* elementName, 
                      const char* property, 
                      const char* value) const;
+    bool _sendSetCmd(const char* pageName, 
+                     const char* elementName, 
+                     const char* property, 
+                     EmNexTextSource& value) const;
     EmGetValueResult _getNumber(int32_t& val) const;
     EmGetValueResult _getString(char* txt, 
-                                uint8_t bufLen, 
+                                uint16_t bufLen, 
                                 const char* elementName) const;
 
 
-    bool _sendCmd(const char* firstCmd, ...) const;
-    bool _sendCmdParam(const char* cmdParam) const;
-    bool _sendCmdEnd() const;
+    bool _sendCmd(const char* cmd) const;
+    bool _sendCmd(EmNexCmdBuf& cmd) const;
+    bool _sendCmd(EmNexCmdBuf& head, 
+                  EmNexTextSource& text, 
+                  const char* tail) const;
+    bool _writeCmd(EmNexCmdBuf& cmd) const;
+    bool _write(const char* data, uint16_t len) const;
     bool _ack(uint8_t ackCode) const;
     EmGetValueResult _recv(uint8_t ackCode, 
                            char* buf, 
-                           uint8_t len, 
+                           uint16_t len, 
                            bool isText=false) const;
-    EmGetValueResult _result(bool result, bool valueChanged) const;
     bool _bResult(bool result) const;
 
     bool _setColor(const char* pageName, 
@@ -232,10 +917,344 @@ protected:
                    const char* elementName, 
                    const char* colorCode, 
                    uint16_t& color565) const;
+
+    bool _batchAppend(const char* data, uint16_t len) const;
+    bool _flushBatch() const;
+    bool _waitBatchEnd() const;
+    bool _endFailuresOnly() const;
+
+    bool _ackAsync(EmNexAsyncCallback callback, 
+                   void* context) const;
+    bool _setColorAsync(const char* pageName, 
+                        const char* elementName, 
+                        const char* colorCode, 
+                        uint16_t color565,
+                        EmNexAsyncCallback callback,
+                        void* context) const;
+    bool _getColorAsync(const char* pageName, 
+                        const char* elementName, 
+                        const char* colorCode, 
+                        uint16_t& color565,
+                        EmNexAsyncCallback callback,
+                        void* context) const;
+    static void _waitDone(EmGetValueResult result, void* context);
+    static void _curPageDone(EmGetValueResult result, void* context);
+    bool _refreshCurPageAsync() const;
+    void _invalidateCurPage() const;
+    void _rxText(char* buf, uint16_t len, uint8_t c) const;
+    void _rxReply(char* buf, uint16_t len) const;
+    void _idle() const;
+
+    bool _readFrame() const;
+    bool _rxByte(uint8_t c) const;
+    bool _pollFrame() const;
+    void _pollFrames() const;
+    void _schedule() const;
+    void _dispatchChanges() const;
+    void _queueEvent(const EmNexEvent& event) const;
+    void _dispatchEvents() const;
+    void _processFrame() const;
+    bool _isFeedback() const;
+    bool _pushPending(uint8_t code, 
+                      char* buf, 
+                      uint16_t len,
+                      EmNexAsyncCallback callback, 
+                      void* context) const;
+    void _popPending(uint8_t code) const;
+    void _dropPending() const;
+    bool _queueBatchAcks() const;
+    void _invalidateCache() const;
+    bool _probe(EmNexSetBaudCallback setBaud, 
+                void* context,
+                uint32_t baud) const;
+    void _discardRx() const;
+    bool _skipStale() const;
+    uint32_t _pendingTimeout() const;
+    uint32_t _txWaitMs() const;
+    void _trackLatency(uint8_t cls, uint32_t latencyMs) const;
+    void _statsCmd(const char* cmd, uint16_t len) const;
+    void _statsTx(uint16_t len) const;
+    void _statsRx() const;
+    void _trace(EmNexTraceKind kind, uint8_t code, uint16_t arg=0) const;
+
 private:
+    // Frame parser state
+    enum RxState: uint8_t {
+        rxCode,
+        rxPayload,
+        rxTerminators
+    };
+
+    // Asynchronous current page query state (a stale reply is dropped)
+    enum PageQuery: uint8_t {
+        pageQueryNone,
+        pageQueryPending,
+        pageQueryStale
+    };
+
+    // A command waiting for display feedback or reply
+    struct PendingCmd {
+        EmNexAsyncCallback callback;
+        void* context;
+        char* buf;     // reply destination
+        uint32_t sentMs;
+        uint16_t txMs; // command transfer time (still being sent)
+        uint16_t tag;
+        uint16_t len;  // reply destination size (or SINK_LEN)
+        uint8_t code;  // expected reply code
+        uint8_t cls;   // latency class
+#ifdef EM_NEX_STATS
+        uint8_t type;  // 'EmNexCmdType'
+#endif
+    };
+
+    // Blocking methods waited reply: each wait has its own slot 
+    // (i.e. callbacks may call blocking methods while a blocking 
+    // method is waiting)
+    struct WaitSlot {
+        EmGetValueResult result;
+        bool waiting;
+    };
+
+    // Text replies destination is an 'EmNexTextSink' object
+    static const uint16_t SINK_LEN = 0xFFFF;
+
     EmComSerial& m_Serial;       
-    const uint32_t m_TimeoutMs;
+    const uint32_t m_BaseTimeoutMs;
+    mutable uint32_t m_TimeoutMs;
+    mutable uint32_t m_Baud;
     mutable bool m_IsInit;
+    // Received frame
+    mutable RxState m_RxState;
+    mutable uint8_t m_RxCode;
+    mutable uint8_t m_RxLen;
+    mutable uint8_t m_RxTerm;
+    mutable uint8_t m_RxPayload[5];
+    // Bytes of a corrupted frame to be parsed again
+    mutable uint8_t m_RxReplay[sizeof(m_RxPayload) + 3];
+    mutable uint8_t m_RxReplayPos;
+    mutable uint8_t m_RxReplayLen;
+    mutable EmNextionRet m_LastError;
+    // Pipelined commands
+    mutable bool m_Pipelined;
+    mutable EmNexCmdCallback m_CmdCallback;
+    mutable void* m_CmdContext;
+    mutable uint16_t m_CmdTag;
+    static_assert(EM_NEX_MAX_PENDING >= 2 && EM_NEX_MAX_PENDING <= 255, 
+                  "EM_NEX_MAX_PENDING out of range");
+    mutable PendingCmd m_Pending[EM_NEX_MAX_PENDING];
+    mutable uint8_t m_PendingHead;
+    mutable uint8_t m_PendingCount;
+    mutable uint16_t m_FailedCount;
+    mutable uint32_t m_PendingStartMs;
+    // When the last written byte is expected on the line (host 
+    // serial may buffer it)
+    mutable uint32_t m_TxEndMs;
+    // Replies latency estimates (ms scaled by 8 and 4 as TCP RTO) 
+    // of feedback, number, string and page command classes
+    mutable uint16_t m_LatAvg8[4];
+    mutable uint16_t m_LatDev4[4];
+    mutable uint8_t m_LatValid;
+    // Last sent command is a page command (see 'ResetLatency')
+    mutable bool m_PageCmd;
+    // Replies of dropped commands may still come
+    mutable bool m_RxStale;
+    // Batched commands
+    mutable char* m_BatchBuf;
+    mutable uint16_t m_BatchSize;
+    mutable uint16_t m_BatchLen;
+    mutable bool m_BatchFailuresOnly;
+    mutable uint16_t m_BatchFailedCount;
+    // Recorded commands success feedbacks not queued yet
+    mutable uint16_t m_BatchAcks;
+    // Commands waiting for feedback when the batch began
+    mutable uint8_t m_BatchPrior;
+    // Shadow values generation
+    mutable uint16_t m_ShadowGen;
+    // Current page cache
+    mutable uint8_t m_CurPage;
+    mutable bool m_CurPageValid;
+    mutable uint8_t m_CurPageReply;
+    mutable PageQuery m_CurPageQuery;
+    // Pending command reply
+    mutable uint16_t m_RxPos;
+    mutable bool m_RxChanged;
+    // Blocking methods idle callback
+    mutable EmNexIdleCallback m_IdleCallback;
+    mutable void* m_IdleContext;
+    // Display events
+    mutable EmNexEventListener* m_Listeners;
+    mutable EmNexEvent m_Events[EM_NEX_MAX_EVENTS];
+    mutable uint8_t m_EventHead;
+    mutable uint8_t m_EventCount;
+    mutable bool m_Dispatching;
+    // Subscriptions
+    mutable EmNexSubscription* m_Subscriptions;
+    mutable uint16_t m_BudgetBps;
+    mutable int32_t m_BudgetBytes;
+    mutable uint32_t m_BudgetMs;
+    // Display refresh suspension
+    mutable uint8_t m_RefreshStops;
+    mutable bool m_RefreshRestore;
+#if EM_NEX_TRACE_SIZE
+    static_assert(EM_NEX_TRACE_SIZE <= 255, "EM_NEX_TRACE_SIZE too big");
+    mutable EmNexTraceRecord m_Trace[EM_NEX_TRACE_SIZE];
+    mutable uint8_t m_TraceHead;
+    mutable uint8_t m_TraceCount;
+#endif
+#ifdef EM_NEX_STATS
+    // Link statistics (and type of the last command sent)
+    mutable EmNexStats m_Stats;
+    mutable uint8_t m_StatsType;
+#endif
+};
+
+// The last element value confirmed by display.
+//
+// NOTES:
+//  1. shadows are disabled by default (see elements 'SetShadowed' method)
+//  2. in pipelined or batch mode the value is stored once the command 
+//     has been sent, a later failure invalidates all shadows
+template<class value_type>
+class EmNexShadow {
+public:
+    EmNexShadow()
+     : m_enabled(false), 
+       m_gen(0) {}
+
+    void Enable(bool enable) {
+        m_enabled = enable;
+        m_gen = 0;
+    }
+
+    bool IsEnabled() const {
+        return m_enabled;
+    }
+
+    bool IsEqual(const EmNextion& nex, value_type value) const {
+        return m_enabled && 
+               m_gen == nex.ShadowGen() && 
+               m_value == value;
+    }
+
+    void Set(const EmNextion& nex, value_type value) {
+        if (m_enabled) {
+            m_value = value;
+            m_gen = nex.ShadowGen();
+        }
+    }
+
+    void Invalidate() {
+        m_gen = 0;
+    }
+
+private:
+    bool m_enabled;
+    uint16_t m_gen;
+    value_type m_value;
+};
+
+// Text shadows store a 32 bits value instead of a text copy (i.e. 
+// shadow RAM does not depend on text length): texts up to 3 characters 
+// are stored as they are, longer ones as their hash (FNV-1a, 31 bits).
+//
+// NOTE: an update of a longer text is skipped if its hash matches the 
+//       one of the text shown by display (about 1 chance in 2 billions 
+//       per update), disable the shadow where it can't be accepted 
+//       (see 'EmNexText::SetShadowed')
+inline uint32_t EmNexTextHash(const char* txt) {
+    uint8_t len = 0;
+    while (len < 4 && 0 != txt[len]) {
+        len++;
+    }
+    if (len < 4) {
+        // Length (high bit clear) and characters
+        uint32_t value = static_cast<uint32_t>(len) << 24;
+        for (uint8_t i = 0; i < len; i++) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(txt[i])) << (8*i);
+        }
+        return value;
+    }
+    uint32_t hash = 2166136261UL;
+    while (*txt) {
+        hash = (hash ^ static_cast<uint8_t>(*txt++)) * 16777619UL;
+    }
+    return hash | 0x80000000UL;
+}
+
+// Scoped batch: commands sent while the object is alive are 
+// recorded and sent with one single serial write by 'Commit' 
+// (or automatically when the object goes out of scope)
+template<uint16_t size>
+class EmNexBatch {
+public:
+    EmNexBatch(const EmNextion& nex, 
+               bool failuresOnly=false)
+     : m_nex(nex),
+       m_active(nex.BeginBatch(m_buf, size, failuresOnly)) {}
+
+    ~EmNexBatch() {
+        Commit();
+    }
+
+    bool Commit() {
+        if (!m_active) {
+            return false;
+        }
+        m_active = false;
+        return m_nex.CommitBatch();
+    }
+
+private:
+    const EmNextion& m_nex;
+    bool m_active;
+    char m_buf[size];
+};
+
+// Scoped waveforms refresh suspension (see 'EmNextion::StopRefresh'):
+// refresh restarts when the object goes out of scope, whatever 
+// happened to commands sent meanwhile
+class EmNexRefreshLock {
+public:
+    EmNexRefreshLock(const EmNextion& nex)
+     : m_nex(nex) {
+        m_nex.StopRefresh();
+    }
+
+    ~EmNexRefreshLock() {
+        m_nex.StartRefresh();
+    }
+
+private:
+    const EmNextion& m_nex;
+};
+
+// Scoped commands burst: like 'EmNexBatch' but an already open 
+// batch is joined (i.e. commands are sent by its commit)
+template<uint16_t size>
+class EmNexBurst {
+public:
+    EmNexBurst(const EmNextion& nex)
+     : m_nex(nex),
+       m_active(!nex.IsBatch() && nex.BeginBatch(m_buf, size, false)) {}
+
+    ~EmNexBurst() {
+        End(true);
+    }
+
+    // Send the burst, returns 'res' if no command failed
+    bool End(bool res) {
+        if (!m_active) {
+            return res;
+        }
+        m_active = false;
+        return m_nex.CommitBatch() && res;
+    }
+
+private:
+    const EmNextion& m_nex;
+    bool m_active;
+    char m_buf[size];
 };
 
 class EmNexObject: public EmLog {
@@ -251,6 +1270,98 @@ protected:
     const char* m_name;
 };
 
+class EmNexPage;
+
+// A page element value read by 'EmNexPage::ReadAll' (see 'EmNexValueOf' 
+// and 'EmNexTextOf' templates)
+class EmNexPageValue {
+public:
+    // Last 'ReadAll' result of this value
+    EmGetValueResult Result() const {
+        return m_result;
+    }
+
+protected:
+    EmNexPageValue()
+     : m_page(NULL),
+       m_next(NULL),
+       m_result(EmGetValueResult::failed) {}
+
+    // Send the asynchronous get of this value
+    virtual bool _getAsync(EmNexAsyncCallback callback, void* context) = 0;
+
+    // Bytes of get command and reply (i.e. read cost)
+    virtual uint16_t _readLen() const = 0;
+
+    static void _done(EmGetValueResult result, void* context) {
+        static_cast<EmNexPageValue*>(context)->m_result = result;
+    }
+
+    const EmNexPage* m_page;
+    EmNexPageValue* m_next;
+    EmGetValueResult m_result;
+
+    friend class EmNexPage;
+    friend class EmNextion;
+};
+
+// Called when a subscribed value changes
+typedef void (*EmNexChangeCallback)(void* context);
+
+// Value read periodically (see 'EmNextion::Subscribe'): 'callback' 
+// is called by 'Poll' when the read value changes.
+//
+// NOTES:
+//  1. 'priority' breaks ties between due reads (higher first)
+//  2. value target is written when read completes, it is also 
+//     read by its page 'ReadAll' (its changes are not notified)
+class EmNexSubscription {
+public:
+    EmNexSubscription(EmNexPageValue& value,
+                      uint32_t periodMs,
+                      uint8_t priority,
+                      EmNexChangeCallback callback,
+                      void* context=NULL)
+     : m_value(value),
+       m_periodMs(periodMs),
+       m_dueMs(0),
+       m_callback(callback),
+       m_context(context),
+       m_next(NULL),
+       m_priority(priority),
+       m_busy(false),
+       m_changed(false) {}
+
+    uint32_t PeriodMs() const {
+        return m_periodMs;
+    }
+
+    void SetPeriodMs(uint32_t periodMs) {
+        m_periodMs = periodMs;
+    }
+
+private:
+    static void _done(EmGetValueResult result, void* context) {
+        EmNexSubscription* subscription = static_cast<EmNexSubscription*>(context);
+        subscription->m_busy = false;
+        if (EmGetValueResult::succeedNotEqualValue == result) {
+            subscription->m_changed = true;
+        }
+    }
+
+    EmNexPageValue& m_value;
+    uint32_t m_periodMs;
+    uint32_t m_dueMs;
+    EmNexChangeCallback m_callback;
+    void* m_context;
+    EmNexSubscription* m_next;
+    uint8_t m_priority;
+    bool m_busy;
+    bool m_changed;
+
+    friend class EmNextion;
+};
+
 class EmNexPage: public EmNexObject
 {
 public:
@@ -260,7 +1371,8 @@ public:
               EmLogLevel logLevel=EmLogLevel::none)
       : EmNexObject(name, logLevel),
         m_nex(nex),
-        m_id(id)
+        m_id(id),
+        m_values(NULL)
     {}
     
     EmNextion& Nex() const {
@@ -279,18 +1391,145 @@ public:
         return Nex().SetCurPage(m_id);
     }
 
+    // Register a value read by 'ReadAll' (done by 'EmNexPageValue' 
+    // derived objects, which must live as long as the page)
+    void AddValue(EmNexPageValue& value) {
+        value.m_page = this;
+        value.m_next = m_values;
+        m_values = &value;
+    }
+
+    // Read all registered values: get commands are sent back-to-back 
+    // and replies are written to their targets as they come (i.e. 
+    // about one round trip plus transfer time). Returns false if any 
+    // value failed (see 'EmNexPageValue::Result').
+    //
+    // NOTE: page should be current (local elements of other pages 
+    //       can't be read)
+    bool ReadAll() const {
+        bool res = true;
+        for (EmNexPageValue* value = m_values; NULL != value; value = value->m_next) {
+            value->m_result = EmGetValueResult::failed;
+            if (!value->_getAsync(EmNexPageValue::_done, value)) {
+                res = false;
+            }
+        }
+        // Targets are written by replies: all of them must be waited
+        Nex().WaitPending();
+        for (EmNexPageValue* value = m_values; NULL != value; value = value->m_next) {
+            if (EmGetValueResult::failed == value->m_result) {
+                res = false;
+            }
+        }
+        return res;
+    }
+
 protected:
     EmNextion& m_nex;
     const uint8_t m_id;
+    EmNexPageValue* m_values;
+};
+
+// Touch events callback
+typedef void (*EmNexTouchCallback)(uint8_t componentId, 
+                                   bool pressed, 
+                                   void* context);
+
+// Calls 'callback' on touch events of a page component 
+// (or any page component if 'componentId' is ANY_COMPONENT)
+//
+// NOTE: listener must be registered by 'EmNextion::AddListener'
+class EmNexTouchListener: public EmNexEventListener {
+public:
+    static const uint8_t ANY_COMPONENT = 0xFF;
+
+    EmNexTouchListener(const EmNexPage& page,
+                       uint8_t componentId,
+                       EmNexTouchCallback callback,
+                       void* context=NULL)
+     : EmNexEventListener(),
+       m_pageId(page.Id()),
+       m_componentId(componentId),
+       m_callback(callback),
+       m_context(context) {}
+
+    virtual void OnNexEvent(const EmNexEvent& event) override {
+        if (EVT_TOUCH == event.code && 
+            m_pageId == event.pageId &&
+            (ANY_COMPONENT == m_componentId || m_componentId == event.componentId)) {
+            m_callback(event.componentId, event.pressed, m_context);
+        }
+    }
+
+protected:
+    const uint8_t m_pageId;
+    const uint8_t m_componentId;
+    EmNexTouchCallback m_callback;
+    void* m_context;
 };
 
+// Element name, or its component ID based reference (e.g. "p[0].b[3]")
+// that costs fewer bytes on serial line than the "page.element" path
+//
+// NOTE: it can be passed where element names are expected (it is 
+//       converted to 'const char*'), as a temporary it lives until 
+//       the end of the full expression
+class EmNexElementName {
+public:
+    static const uint8_t NO_COMPONENT_ID = 0xFF;
+
+    EmNexElementName(const char* name)
+     : m_name(name) {}
+
+    // "p[<pageId>].b[<componentId>]" path (if 'pageId' is 
+    // NO_PAGE_ID just the "<componentId>" of current page)
+    EmNexElementName(uint8_t pageId, uint8_t componentId)
+     : m_name(NULL) {
+        if (NO_PAGE_ID == pageId) {
+            snprintf(m_buf, sizeof(m_buf), "%u", componentId);
+        } else {
+            snprintf(m_buf, sizeof(m_buf), "p[%u].b[%u]", pageId, componentId);
+        }
+    }
+
+    operator const char*() const {
+        return (NULL != m_name) ? m_name : m_buf;
+    }
+
+    static const uint8_t NO_PAGE_ID = 0xFF;
+
+private:
+    const char* m_name;
+    char m_buf[14];
+};
+
+// Max length of the "page.element" path precomputed by page elements 
+// (0: page and element names are assembled by each command).
+//
+// NOTE: each page element costs EM_NEX_MAX_PATH_LEN+2 bytes of RAM, 
+//       default is 0 on AVR (i.e. RAM is scarce, e.g. 20 elements 
+//       would take more than a quarter of an Arduino UNO RAM). Longer 
+//       paths fall back to page and element names
+#ifndef EM_NEX_MAX_PATH_LEN
+#ifdef __AVR__
+#define EM_NEX_MAX_PATH_LEN 0
+#else
+#define EM_NEX_MAX_PATH_LEN 24
+#endif
+#endif
+
 template<EmNexPage& page>
 class EmNexPageElement: public EmNexObject
 {
 public:
     EmNexPageElement(const char* name,
                      EmLogLevel logLevel=EmLogLevel::none)
-     : EmNexObject(name, logLevel) {}
+     : EmNexObject(name, logLevel),
+       m_componentId(EmNexElementName::NO_COMPONENT_ID)
+#if EM_NEX_MAX_PATH_LEN > 0
+       , m_pathLen(0)
+#endif
+     {}
 
     EmNextion& Nex() const {
         return page.Nex();
@@ -304,6 +1543,18 @@ public:
         return page.Name();
     }
 
+    // Address element by its component ID instead of its 
+    // name (i.e. shorter commands, see 'EmNexElementName')
+    //
+    // NOTE: ID must match the 'id' attribute in Nextion editor
+    void SetComponentId(uint8_t componentId) {
+        m_componentId = componentId;
+    }
+
+    uint8_t ComponentId() const {
+        return m_componentId;
+    }
+
     // Set element visibility.
     //
     // NOTES:
@@ -311,7 +1562,7 @@ public:
     //  2. visibility attribute is reset if page is changed 
     //     or display recovers from screen saver
     bool SetVisible(bool visible) const {
-        return Nex().SetVisible(page.Id(), m_name, visible);
+        return Nex().SetVisible(page.Id(), _componentName(), visible);
     }
 
     // Simulate a 'Click' event.
@@ -320,8 +1571,79 @@ public:
     //  1. element should be in current page
     //  2. if pressed = False a release event is sent
     bool Click(bool pressed = true) const {
-        return Nex().Click(page.Id(), m_name, pressed);
+        return Nex().Click(page.Id(), _componentName(), pressed);
+    }
+
+    // Asynchronous methods (see 'EmNextion' asynchronous methods)
+    bool SetVisibleAsync(bool visible,
+                         EmNexAsyncCallback callback=NULL,
+                         void* context=NULL) const {
+        return Nex().SetVisibleAsync(page.Id(), _componentName(), visible, callback, context);
+    }
+
+    bool ClickAsync(bool pressed,
+                    EmNexAsyncCallback callback=NULL,
+                    void* context=NULL) const {
+        return Nex().ClickAsync(page.Id(), _componentName(), pressed, callback, context);
+    }
+
+protected:
+    // Element reference passed to display methods: the component IDs 
+    // path or the precomputed path (and no page name) or page and 
+    // element names
+    bool _hasComponentId() const {
+        return EmNexElementName::NO_COMPONENT_ID != m_componentId;
+    }
+
+    const char* _pageName() const {
+        return (_hasComponentId() || NULL != _path()) ? NULL : page.Name();
     }
+
+    EmNexElementName _elementName() const {
+        if (_hasComponentId()) {
+            return EmNexElementName(page.Id(), m_componentId);
+        }
+        const char* path = _path();
+        return EmNexElementName((NULL != path) ? path : this->m_name);
+    }
+
+    // Current page element reference (i.e. 'vis' and 'click' commands)
+    EmNexElementName _componentName() const {
+        return _hasComponentId() ? 
+            EmNexElementName(EmNexElementName::NO_PAGE_ID, m_componentId) :
+            EmNexElementName(this->m_name);
+    }
+
+    uint8_t m_componentId;
+
+#if EM_NEX_MAX_PATH_LEN > 0
+    // NOTE: path is built at first use since page might be 
+    //       constructed after this element (i.e. global objects 
+    //       of different translation units)
+    const char* _path() const {
+        if (0 == m_pathLen) {
+            size_t pageLen = strlen(page.Name());
+            size_t nameLen = strlen(this->m_name);
+            if (pageLen+1+nameLen > EM_NEX_MAX_PATH_LEN) {
+                m_pathLen = PATH_TOO_LONG;
+            } else {
+                memcpy(m_path, page.Name(), pageLen);
+                m_path[pageLen] = '.';
+                memcpy(m_path+pageLen+1, this->m_name, nameLen+1);
+                m_pathLen = static_cast<uint8_t>(pageLen+1+nameLen);
+            }
+        }
+        return (PATH_TOO_LONG == m_pathLen) ? NULL : m_path;
+    }
+
+    static const uint8_t PATH_TOO_LONG = 0xFF;
+    mutable uint8_t m_pathLen;
+    mutable char m_path[EM_NEX_MAX_PATH_LEN+1];
+#else
+    const char* _path() const {
+        return NULL;
+    }
+#endif
 };
 
 template<EmNexPage& page>
@@ -334,12 +1656,25 @@ public:
 
     // Set element picture (only for picture objects).
     bool SetPicture(uint8_t picId) const {
-        return this->Nex().SetPicture(page.Name(), this->m_name, picId);
+        return this->Nex().SetPicture(this->_pageName(), this->_elementName(), picId);
     }
 
     // Get element picture (only for picture objects).
     bool GetPicture(uint8_t& picId) const {
-        return this->Nex().GetPicture(page.Name(), this->m_name, picId);
+        return this->Nex().GetPicture(this->_pageName(), this->_elementName(), picId);
+    }
+
+    // Asynchronous methods (see 'EmNextion' asynchronous methods)
+    bool SetPictureAsync(uint8_t picId,
+                         EmNexAsyncCallback callback=NULL,
+                         void* context=NULL) const {
+        return this->Nex().SetPictureAsync(this->_pageName(), this->_elementName(), picId, callback, context);
+    }
+
+    bool GetPictureAsync(uint8_t& picId,
+                         EmNexAsyncCallback callback,
+                         void* context=NULL) const {
+        return this->Nex().GetPictureAsync(this->_pageName(), this->_elementName(), picId, callback, context);
     }
 };
 
@@ -356,14 +1691,14 @@ public:
     bool SetBkColor(uint8_t red,
                     uint8_t green,
                     uint8_t blue) const {
-        return this->Nex().SetBkColor(page.Name(), 
-                                      this->m_name, 
+        return this->Nex().SetBkColor(this->_pageName(), 
+                                      this->_elementName(), 
                                       ToColor565(red, green, blue));
     }
 
     bool SetBkColor(uint16_t color565) const {
-        return this->Nex().SetBkColor(page.Name(), 
-                                      this->m_name, 
+        return this->Nex().SetBkColor(this->_pageName(), 
+                                      this->_elementName(), 
                                       color565);
     }
 
@@ -371,14 +1706,14 @@ public:
     bool GetBkColor(uint8_t& red,
                     uint8_t& green,
                     uint8_t& blue) const {
-        return this->Nex().GetBkColor(page.Name(), 
-                                      this->m_name, 
+        return this->Nex().GetBkColor(this->_pageName(), 
+                                      this->_elementName(), 
                                       red, green, blue);
     }
 
     bool GetBkColor(uint16_t& color565) const {
-        return this->Nex().GetBkColor(page.Name(), 
-                                      this->m_name, 
+        return this->Nex().GetBkColor(this->_pageName(), 
+                                      this->_elementName(), 
                                       color565);
     }
 
@@ -386,14 +1721,14 @@ public:
     bool SetFontColor(uint8_t red,
                       uint8_t green,
                       uint8_t blue) const {
-        return this->Nex().SetFontColor(page.Name(), 
-                                        this->m_name, 
+        return this->Nex().SetFontColor(this->_pageName(), 
+                                        this->_elementName(), 
                                         red, green, blue);
     }
 
     bool SetFontColor(uint16_t color565) const {
-        return this->Nex().SetFontColor(page.Name(), 
-                                        this->m_name, 
+        return this->Nex().SetFontColor(this->_pageName(), 
+                                        this->_elementName(), 
                                         color565);
     }
 
@@ -401,17 +1736,41 @@ public:
     bool GetFontColor(uint8_t& red,
                       uint8_t& green,
                       uint8_t& blue) const {
-        return this->Nex().GetFontColor(page.Name(), 
-                                        this->m_name, 
+        return this->Nex().GetFontColor(this->_pageName(), 
+                                        this->_elementName(), 
                                         red, green, blue);
     }
 
     bool GetFontColor(uint16_t& color565) const {
-        return this->Nex().GetFontColor(page.Name(), 
-                                        this->m_name, 
+        return this->Nex().GetFontColor(this->_pageName(), 
+                                        this->_elementName(), 
                                         color565);
     }
 
+    // Asynchronous methods (see 'EmNextion' asynchronous methods)
+    bool SetBkColorAsync(uint16_t color565,
+                         EmNexAsyncCallback callback=NULL,
+                         void* context=NULL) const {
+        return this->Nex().SetBkColorAsync(this->_pageName(), this->_elementName(), color565, callback, context);
+    }
+
+    bool GetBkColorAsync(uint16_t& color565,
+                         EmNexAsyncCallback callback,
+                         void* context=NULL) const {
+        return this->Nex().GetBkColorAsync(this->_pageName(), this->_elementName(), color565, callback, context);
+    }
+
+    bool SetFontColorAsync(uint16_t color565,
+                           EmNexAsyncCallback callback=NULL,
+                           void* context=NULL) const {
+        return this->Nex().SetFontColorAsync(this->_pageName(), this->_elementName(), color565, callback, context);
+    }
+
+    bool GetFontColorAsync(uint16_t& color565,
+                           EmNexAsyncCallback callback,
+                           void* context=NULL) const {
+        return this->Nex().GetFontColorAsync(this->_pageName(), this->_elementName(), color565, callback, context);
+    }
 };
 
 template<EmNexPage& page>
@@ -424,11 +1783,48 @@ public:
 
     template<size_t len>
     EmGetValueResult GetValue(char* value) const {
-        return this->Nex().GetTextElementValue<len>(this->PageName(), this->m_name, value);
+        EmGetValueResult res = this->Nex().template GetTextElementValue<len>(this->_pageName(), 
+                                                                             this->_elementName(), 
+                                                                             value);
+        if (EmGetValueResult::failed != res) {
+            // A text filling 'value' might be truncated (i.e. not 
+            // the one display shows)
+            if (strlen(value) < len) {
+                m_shadow.Set(this->Nex(), EmNexTextHash(value));
+            } else {
+                m_shadow.Invalidate();
+            }
+        }
+        return res;
     }
 
     bool SetValue(const char* value) const {
-        return this->Nex().SetTextElementValue(this->PageName(), this->m_name, value);
+        uint32_t hash = EmNexTextHash(value);
+        if (m_shadow.IsEqual(this->Nex(), hash)) {
+            return true;
+        }
+        bool res = this->Nex().SetTextElementValue(this->_pageName(), this->_elementName(), value);
+        if (res) {
+            m_shadow.Set(this->Nex(), hash);
+        }
+        return res;
+    }
+
+    // Streamed texts (see 'EmNextion' streamed texts methods)
+    //
+    // NOTE: shadow value is not tracked for streamed texts
+    EmGetValueResult GetValue(EmNexTextSink& sink) const {
+        m_shadow.Invalidate();
+        return this->Nex().GetTextElementValue(this->_pageName(), 
+                                               this->_elementName(), 
+                                               sink);
+    }
+
+    bool SetValue(EmNexTextSource& source) const {
+        m_shadow.Invalidate();
+        return this->Nex().SetTextElementValue(this->_pageName(), 
+                                               this->_elementName(), 
+                                               source);
     }
 
     template <uint16_t max_len>
@@ -438,8 +1834,40 @@ public:
         va_start(args, format);     
         vsnprintf(text, max_len+1, format, args);
         va_end(args);
-        return this->Nex().SetTextElementValue(this->PageName(), this->m_name, text);
+        return EmNexText<page>::SetValue(text);
+    }
+
+    // Asynchronous methods (see 'EmNextion' asynchronous methods)
+    //
+    // NOTE: shadow value is not confirmed by asynchronous methods
+    template<size_t len>
+    bool GetValueAsync(char* value,
+                       EmNexAsyncCallback callback,
+                       void* context=NULL) const {
+        m_shadow.Invalidate();
+        return this->Nex().GetTextElementValueAsync(this->_pageName(), 
+                                                    this->_elementName(), 
+                                                    value, len+1, 
+                                                    callback, context);
+    }
+
+    bool SetValueAsync(const char* value,
+                       EmNexAsyncCallback callback=NULL,
+                       void* context=NULL) const {
+        m_shadow.Invalidate();
+        return this->Nex().SetTextElementValueAsync(this->_pageName(), 
+                                                    this->_elementName(), 
+                                                    value, 
+                                                    callback, context);
+    }
+
+    // Skip 'SetValue' serial transaction if display already shows the value
+    void SetShadowed(bool shadowed) const {
+        m_shadow.Enable(shadowed);
     }
+
+protected:
+    mutable EmNexShadow<uint32_t> m_shadow;
 };
 
 // Use 'EmNexTextEx' class if you need an 'EmValue' object 
@@ -458,7 +1886,7 @@ public:
         //  Since 'GetValue' overrides a virtual method it can not 
         //  be template based. 100 should be a good compromise.
         //  To use exact len please use the templated 'getValue' method. 
-        return EmNexText<page>::GetValue<100>(value);
+        return EmNexText<page>::template GetValue<100>(value);
     }
 
     virtual bool SetValue(const char* value) override {
@@ -466,6 +1894,123 @@ public:
     }
 };
 
+// Scrolling log/console text: appended texts are sent alone ('txt+=') 
+// and oldest ones are cut with one command when 'capacity' characters 
+// or 'max_lines' appended texts are exceeded.
+//
+// NOTES:
+//  1. each appended text is a trimming unit (e.g. a line ending by "\r")
+//  2. 'capacity' must not exceed element 'txt_maxl' attribute
+//  3. display text is cleared when it is not known anymore (i.e. on 
+//     shadows invalidation, see 'EmNextion::ShadowGen')
+template<EmNexPage& page, uint16_t capacity, uint8_t max_lines=8>
+class EmNexConsole: public EmNexText<page>
+{
+public:
+    EmNexConsole(const char* name,
+                 EmLogLevel logLevel=EmLogLevel::none)
+     : EmNexText<page>(name, logLevel),
+       m_gen(0),
+       m_len(0),
+       m_first(0),
+       m_count(0) {}
+
+    bool Clear() const {
+        this->m_shadow.Invalidate();
+        m_gen = 0;
+        if (!this->Nex().SetTextElementValue(this->_pageName(), this->_elementName(), "")) {
+            return false;
+        }
+        _reset(0);
+        return true;
+    }
+
+    bool Append(const char* text) const {
+        uint16_t textLen = strlen(text);
+        if (textLen > capacity) {
+            // Only the tail fits
+            text += textLen - capacity;
+            textLen = capacity;
+        }
+        if (m_gen != this->Nex().ShadowGen()) {
+            // Display text is unknown: it is replaced
+            _reset(0);
+        }
+        // Oldest texts are cut first
+        uint16_t cut = 0;
+        while (m_count && (m_count == max_lines || m_len - cut + textLen > capacity)) {
+            cut += m_lines[m_first];
+            m_first = (m_first + 1) % max_lines;
+            m_count--;
+        }
+        this->m_shadow.Invalidate();
+        bool res = true;
+        if (cut == m_len) {
+            res = this->Nex().SetTextElementValue(this->_pageName(), this->_elementName(), text);
+        } else {
+            res = (0 == cut || 
+                   this->Nex().SubTextElementValue(this->_pageName(), 
+                                                   this->_elementName(), 
+                                                   cut, m_len - cut)) &&
+                  this->Nex().AppendTextElementValue(this->_pageName(), 
+                                                     this->_elementName(), 
+                                                     text);
+        }
+        if (!res) {
+            m_gen = 0;
+            return false;
+        }
+        m_len -= cut;
+        m_len += textLen;
+        m_lines[(m_first + m_count) % max_lines] = textLen;
+        m_count++;
+        return true;
+    }
+
+    template <uint16_t max_len>
+    bool Append(const char* format, ...) const {
+        char text[max_len+1];
+        va_list args;
+        va_start(args, format);     
+        vsnprintf(text, max_len+1, format, args);
+        va_end(args);
+        return Append(text);
+    }
+
+    // Whole text replacement (i.e. one trimming unit)
+    bool SetValue(const char* value) const {
+        m_gen = 0;
+        if (!EmNexText<page>::SetValue(value)) {
+            return false;
+        }
+        _reset(strlen(value));
+        return true;
+    }
+
+    // Characters shown by display
+    uint16_t Len() const {
+        return m_len;
+    }
+
+protected:
+    void _reset(uint16_t len) const {
+        m_gen = this->Nex().ShadowGen();
+        m_len = len;
+        m_first = 0;
+        m_count = 0;
+        if (len) {
+            m_lines[0] = len;
+            m_count = 1;
+        }
+    }
+
+    mutable uint16_t m_gen;
+    mutable uint16_t m_len;
+    mutable uint16_t m_lines[max_lines];
+    mutable uint8_t m_first;
+    mutable uint8_t m_count;
+};
+
 template<EmNexPage& page>
 class EmNexInteger: public EmNexColoredElement<page>
 {
@@ -486,16 +2031,58 @@ public:
     }
 
     EmGetValueResult GetValue(int32_t& value) const {
-        return this->Nex().GetNumElementValue(this->PageName(), 
-                                              this->m_name, 
-                                              value);
+        EmGetValueResult res = this->Nex().GetNumElementValue(this->_pageName(), 
+                                                              this->_elementName(), 
+                                                              value);
+        if (EmGetValueResult::failed != res) {
+            m_shadow.Set(this->Nex(), value);
+        }
+        return res;
     }
 
     bool SetValue(int32_t const value) const {
-        return this->Nex().SetNumElementValue(this->PageName(), 
-                                              this->m_name, 
-                                              value);
+        if (m_shadow.IsEqual(this->Nex(), value)) {
+            return true;
+        }
+        bool res = this->Nex().SetNumElementValue(this->_pageName(), 
+                                                  this->_elementName(), 
+                                                  value);
+        if (res) {
+            m_shadow.Set(this->Nex(), value);
+        }
+        return res;
     }
+
+    // Asynchronous methods (see 'EmNextion' asynchronous methods)
+    //
+    // NOTE: shadow value is not confirmed by asynchronous methods
+    bool GetValueAsync(int32_t& value,
+                       EmNexAsyncCallback callback,
+                       void* context=NULL) const {
+        m_shadow.Invalidate();
+        return this->Nex().GetNumElementValueAsync(this->_pageName(), 
+                                                   this->_elementName(), 
+                                                   value, 
+                                                   callback, context);
+    }
+
+    bool SetValueAsync(int32_t const value,
+                       EmNexAsyncCallback callback=NULL,
+                       void* context=NULL) const {
+        m_shadow.Invalidate();
+        return this->Nex().SetNumElementValueAsync(this->_pageName(), 
+                                                   this->_elementName(), 
+                                                   value, 
+                                                   callback, context);
+    }
+
+    // Skip 'SetValue' serial transaction if display already shows the value
+    void SetShadowed(bool shadowed) const {
+        m_shadow.Enable(shadowed);
+    }
+
+protected:
+    mutable EmNexShadow<int32_t> m_shadow;
 };
 
 // Use 'EmNexIntegerEx' class if you need an 'EmValue' object 
@@ -532,10 +2119,11 @@ public:
     template <class real_type>
     EmGetValueResult GetValue(real_type& value) const {
         int32_t val = iMolt<real_type>(value, iPow10(m_decPlaces));
-        EmGetValueResult res = this->Nex().GetNumElementValue(this->Page().Name(), 
-                                                              this->m_name, 
+        EmGetValueResult res = this->Nex().GetNumElementValue(this->_pageName(), 
+                                                              this->_elementName(), 
                                                               val);
         if (EmGetValueResult::failed != res) {
+            m_shadow.Set(this->Nex(), val);
             value = static_cast<real_type>(val)/pow(10, m_decPlaces);
         }
         return res;
@@ -543,9 +2131,17 @@ public:
  
     template <class real_type>
     bool SetValue(real_type const value) {
-        return this->Nex().SetNumElementValue(this->PageName(), 
-                                             this->m_name, 
-                                             iRound<real_type>(value*iPow10(m_decPlaces)));
+        int32_t dispValue = iRound<real_type>(value*iPow10(m_decPlaces));
+        if (m_shadow.IsEqual(this->Nex(), dispValue)) {
+            return true;
+        }
+        bool res = this->Nex().SetNumElementValue(this->_pageName(), 
+                                                  this->_elementName(), 
+                                                  dispValue);
+        if (res) {
+            m_shadow.Set(this->Nex(), dispValue);
+        }
+        return res;
     }
 
     EmGetValueResult GetValue(double& value) const {
@@ -556,8 +2152,46 @@ public:
         return SetValue<double>(value);
     }
 
+    // Asynchronous methods (see 'EmNextion' asynchronous methods)
+    //
+    // NOTES:
+    //  1. 'dispValue' is the integer value shown by display 
+    //     (use 'ToValue' to convert it)
+    //  2. shadow value is not confirmed by asynchronous methods
+    //  3. a gated 'SetValueAsync' (i.e. display value unchanged) calls 
+    //     'callback' before returning (result is 'succeedEqualValue')
+    bool GetValueAsync(int32_t& dispValue,
+                       EmNexAsyncCallback callback,
+                       void* context=NULL) const {
+        m_shadow.Invalidate();
+        return this->Nex().GetNumElementValueAsync(this->_pageName(), 
+                                                   this->_elementName(), 
+                                                   dispValue, 
+                                                   callback, context);
+    }
+
+    bool SetValueAsync(double const value,
+                       EmNexAsyncCallback callback=NULL,
+                       void* context=NULL) const {
+        m_shadow.Invalidate();
+        return this->Nex().SetNumElementValueAsync(this->_pageName(), 
+                                                   this->_elementName(), 
+                                                   iRound<double>(value*iPow10(m_decPlaces)), 
+                                                   callback, context);
+    }
+
+    double ToValue(int32_t dispValue) const {
+        return static_cast<double>(dispValue)/pow(10, m_decPlaces);
+    }
+
+    // Skip 'SetValue' serial transaction if display already shows the value
+    void SetShadowed(bool shadowed) const {
+        m_shadow.Enable(shadowed);
+    }
+
 protected:
     const uint8_t m_decPlaces;
+    mutable EmNexShadow<int32_t> m_shadow;
 };
 
 // Use 'EmNexRealEx' class if you need an 'EmValue' object 
@@ -597,12 +2231,22 @@ public:
     bool SetValue(double const value) {
         int32_t exp = iPow10(this->m_decPlaces);
         int32_t dispValue = iRound(value*static_cast<double>(exp));
-        return this->Nex().SetNumElementValue(this->Page().Name(), 
-                                              this->m_name, 
-                                              iDiv(dispValue, exp)) &&
-               this->Nex().SetNumElementValue(this->Page().Name(), 
-                                              this->m_decElementName, 
-                                              dispValue % exp);        
+        if (m_shadow.IsEqual(this->Nex(), dispValue)) {
+            return true;
+        }
+        // Both labels are updated by one write (i.e. no tearing)
+        EmNexBurst<DEC_BURST_SIZE> burst(this->Nex());
+        bool res = this->Nex().SetNumElementValue(this->_pageName(), 
+                                                  this->_elementName(), 
+                                                  iDiv(dispValue, exp)) &&
+                   this->Nex().SetNumElementValue(this->Page().Name(), 
+                                                  this->m_decElementName, 
+                                                  dispValue % exp);        
+        res = burst.End(res);
+        if (res) {
+            m_shadow.Set(this->Nex(), dispValue);
+        }
+        return res;
     }
 
     EmGetValueResult GetValue(float& value) const {
@@ -616,21 +2260,22 @@ public:
 
     EmGetValueResult GetValue(double& value) const { 
         double prevValue = value;
-        EmGetValueResult res;
-        int32_t intVal;
-        res = this->Nex().GetNumElementValue(this->Page().Name(), 
-                                             this->m_name, 
-                                             intVal);
-        if (res == EmGetValueResult::failed) {
-            return EmGetValueResult::failed;
-        }
-        int32_t decVal;
-        res = this->Nex().GetNumElementValue(this->Page().Name(), 
-                                             m_decElementName, 
-                                             decVal);
-        if (res == EmGetValueResult::failed) {
+        int32_t intVal = 0;
+        int32_t decVal = 0;
+        if (this->Nex().IsBatch()) {
+            // Gets can't join a batch, labels are read one by one
+            if (EmGetValueResult::failed == this->Nex().GetNumElementValue(this->_pageName(), 
+                                                                           this->_elementName(), 
+                                                                           intVal) ||
+                EmGetValueResult::failed == this->Nex().GetNumElementValue(this->Page().Name(), 
+                                                                           m_decElementName, 
+                                                                           decVal)) {
+                return EmGetValueResult::failed;
+            }
+        } else if (!_getBoth(intVal, decVal)) {
             return EmGetValueResult::failed;
         }
+        m_shadow.Set(this->Nex(), intVal*iPow10(m_decPlaces)+decVal);
         value = intVal+(static_cast<double>(decVal)/pow(10, m_decPlaces));
 
         return prevValue == value ? 
@@ -639,51 +2284,93 @@ public:
     }
 
 
-    // Set background color.
+    // Set background color (both labels by one write).
     bool SetBkColor(uint8_t red,
                     uint8_t green,
                     uint8_t blue) const {
-        return this->Nex().SetBkColor(page.Name(), 
-                                      this-> m_name, 
-                                      ToColor565(red, green, blue)) &&
-               this->Nex().SetBkColor(page.Name(), 
-                                      m_decElementName, 
-                                      ToColor565(red, green, blue));
+        return SetBkColor(ToColor565(red, green, blue));
     }
 
     bool SetBkColor(uint16_t color565) const {
-        return this->Nex().SetBkColor(page.Name(), 
-                                      this->m_name, 
-                                      color565) &&
-               this->Nex().SetBkColor(page.Name(), 
-                                      m_decElementName, 
-                                      color565);
+        EmNexBurst<DEC_BURST_SIZE> burst(this->Nex());
+        return burst.End(this->Nex().SetBkColor(this->_pageName(), 
+                                                this->_elementName(), 
+                                                color565) &&
+                         this->Nex().SetBkColor(page.Name(), 
+                                                m_decElementName, 
+                                                color565));
     }
 
-    // Set font color.
+    // Set font color (both labels by one write).
     bool SetFontColor(uint8_t red,
                       uint8_t green,
                       uint8_t blue) const {
-        return this->Nex().SetFontColor(page.Name(), 
-                                        this->m_name, 
-                                        red, green, blue) &&
-               this->Nex().SetFontColor(page.Name(), 
-                                        m_decElementName, 
-                                        red, green, blue);
+        return SetFontColor(ToColor565(red, green, blue));
     }
 
     bool SetFontColor(uint16_t color565) const {
-        return this->Nex().SetFontColor(page.Name(), 
-                                        this->m_name, 
-                                        color565) &&
-               this->Nex().SetFontColor(page.Name(), 
-                                        m_decElementName, 
-                                        color565);
+        EmNexBurst<DEC_BURST_SIZE> burst(this->Nex());
+        return burst.End(this->Nex().SetFontColor(this->_pageName(), 
+                                                  this->_elementName(), 
+                                                  color565) &&
+                         this->Nex().SetFontColor(page.Name(), 
+                                                  m_decElementName, 
+                                                  color565));
+    }
+
+    // Skip 'SetValue' serial transactions if display already shows the value
+    void SetShadowed(bool shadowed) const {
+        m_shadow.Enable(shadowed);
     }
 
 protected:
+    // Both labels set commands
+    static const uint16_t DEC_BURST_SIZE = 64;
+
+    struct GetBoth {
+        uint8_t done;
+        bool failed;
+    };
+
+    static void _onGet(EmGetValueResult result, void* context) {
+        GetBoth* state = static_cast<GetBoth*>(context);
+        state->done++;
+        if (EmGetValueResult::failed == result) {
+            state->failed = true;
+        }
+    }
+
+    // Both labels get commands are sent by one write and 
+    // their replies are waited together
+    bool _getBoth(int32_t& intVal, int32_t& decVal) const {
+        GetBoth state = { 0, false };
+        uint8_t sent = 0;
+        {
+            EmNexBurst<DEC_BURST_SIZE> burst(this->Nex());
+            if (this->Nex().GetNumElementValueAsync(this->_pageName(), 
+                                                    this->_elementName(), 
+                                                    intVal, 
+                                                    _onGet, &state)) {
+                sent++;
+                if (this->Nex().GetNumElementValueAsync(this->Page().Name(), 
+                                                        m_decElementName, 
+                                                        decVal, 
+                                                        _onGet, &state)) {
+                    sent++;
+                }
+            }
+        }
+        // NOTE: replies are written into caller variables, 
+        //       so they must be waited anyway
+        if (state.done < sent) {
+            this->Nex().WaitPending();
+        }
+        return 2 == sent && !state.failed;
+    }
+
     const char* m_decElementName;
     const uint8_t m_decPlaces;
+    mutable EmNexShadow<int32_t> m_shadow;
 };
 
 // Use 'EmNexDecimalEx' class if you need an 'EmValue' object 
@@ -708,6 +2395,338 @@ public:
     }
 };
 
+// Element showing an engineering units value in [minValue, maxValue] 
+// range as an integer in [dispMin, dispMax] range (e.g. a gauge angle).
+//
+// NOTE: updates are change gated: value is sent only if its quantized 
+//       display value changes (shadow is enabled by default)
+template<EmNexPage& page>
+class EmNexRangeElement: public EmNexColoredElement<page>
+{
+public:
+    EmNexRangeElement(const char* name,
+                      double minValue,
+                      double maxValue,
+                      int32_t dispMin,
+                      int32_t dispMax,
+                      EmLogLevel logLevel=EmLogLevel::none)
+     : EmNexColoredElement<page>(name, logLevel),
+       m_minValue(minValue),
+       m_maxValue(maxValue),
+       m_dispMin(dispMin),
+       m_dispMax(dispMax) {
+        m_shadow.Enable(true);
+    }
+
+    EmGetValueResult GetValue(double& value) const {
+        int32_t dispValue = ToDisplay(value);
+        EmGetValueResult res = this->Nex().GetNumElementValue(this->_pageName(), 
+                                                              this->_elementName(), 
+                                                              dispValue);
+        if (EmGetValueResult::failed != res) {
+            m_shadow.Set(this->Nex(), dispValue);
+            value = ToValue(dispValue);
+        }
+        return res;
+    }
+
+    bool SetValue(double const value) const {
+        int32_t dispValue = ToDisplay(value);
+        if (m_shadow.IsEqual(this->Nex(), dispValue)) {
+            return true;
+        }
+        bool res = this->Nex().SetNumElementValue(this->_pageName(), 
+                                                  this->_elementName(), 
+                                                  dispValue);
+        if (res) {
+            m_shadow.Set(this->Nex(), dispValue);
+        }
+        return res;
+    }
+
+    // Asynchronous methods (see 'EmNextion' asynchronous methods)
+    //
+    // NOTES:
+    //  1. 'dispValue' is the integer value shown by display 
+    //     (use 'ToValue' to convert it)
+    //  2. shadow value is not confirmed by asynchronous methods
+    //  3. a gated 'SetValueAsync' (i.e. display value unchanged) calls 
+    //     'callback' before returning (result is 'succeedEqualValue')
+    bool GetValueAsync(int32_t& dispValue,
+                       EmNexAsyncCallback callback,
+                       void* context=NULL) const {
+        m_shadow.Invalidate();
+        return this->Nex().GetNumElementValueAsync(this->_pageName(), 
+                                                   this->_elementName(), 
+                                                   dispValue, 
+                                                   callback, context);
+    }
+
+    bool SetValueAsync(double const value,
+                       EmNexAsyncCallback callback=NULL,
+                       void* context=NULL) const {
+        int32_t dispValue = ToDisplay(value);
+        if (m_shadow.IsEqual(this->Nex(), dispValue)) {
+            if (NULL != callback) {
+                callback(EmGetValueResult::succeedEqualValue, context);
+            }
+            return true;
+        }
+        m_shadow.Invalidate();
+        return this->Nex().SetNumElementValueAsync(this->_pageName(), 
+                                                   this->_elementName(), 
+                                                   dispValue, 
+                                                   callback, context);
+    }
+
+    // Value to display range (values out of range are clamped)
+    int32_t ToDisplay(double value) const {
+        if (m_maxValue == m_minValue) {
+            return m_dispMin;
+        }
+        double ratio = (value - m_minValue)/(m_maxValue - m_minValue);
+        if (ratio < 0) {
+            ratio = 0;
+        } else if (ratio > 1) {
+            ratio = 1;
+        }
+        return m_dispMin + iRound<double>(ratio*(m_dispMax - m_dispMin));
+    }
+
+    double ToValue(int32_t dispValue) const {
+        if (m_dispMax == m_dispMin) {
+            return m_minValue;
+        }
+        return m_minValue + 
+               (m_maxValue - m_minValue)*(dispValue - m_dispMin)/(m_dispMax - m_dispMin);
+    }
+
+    // Disable change gating (e.g. if display might change the value)
+    void SetShadowed(bool shadowed) const {
+        m_shadow.Enable(shadowed);
+    }
+
+protected:
+    const double m_minValue;
+    const double m_maxValue;
+    const int32_t m_dispMin;
+    const int32_t m_dispMax;
+    mutable EmNexShadow<int32_t> m_shadow;
+};
+
+// Progress bar: value is shown as a 0-100 percentage
+template<EmNexPage& page>
+class EmNexProgressBar: public EmNexRangeElement<page>
+{
+public:
+    EmNexProgressBar(const char* name,
+                     double minValue=0,
+                     double maxValue=100,
+                     EmLogLevel logLevel=EmLogLevel::none)
+     : EmNexRangeElement<page>(name, minValue, maxValue, 0, 100, logLevel) {}
+};
+
+// Gauge: value is shown as a needle angle (degrees), by default 
+// the full turn (e.g. 0 to 180 for a half dial)
+template<EmNexPage& page>
+class EmNexGauge: public EmNexRangeElement<page>
+{
+public:
+    EmNexGauge(const char* name,
+               double minValue,
+               double maxValue,
+               int32_t minAngle=0,
+               int32_t maxAngle=360,
+               EmLogLevel logLevel=EmLogLevel::none)
+     : EmNexRangeElement<page>(name, minValue, maxValue, minAngle, maxAngle, logLevel) {}
+};
+
+// Slider: value is shown in slider 'minval'-'maxval' range
+//
+// NOTE: user can move the slider, 'GetValue' refreshes the value 
+//       used to gate updates (or disable it by 'SetShadowed')
+template<EmNexPage& page>
+class EmNexSlider: public EmNexRangeElement<page>
+{
+public:
+    EmNexSlider(const char* name,
+                double minValue,
+                double maxValue,
+                int32_t minVal=0,
+                int32_t maxVal=100,
+                EmLogLevel logLevel=EmLogLevel::none)
+     : EmNexRangeElement<page>(name, minValue, maxValue, minVal, maxVal, logLevel) {}
+};
+
+// Numeric element value registered to its page 'ReadAll' (e.g. an 
+// 'EmNexInteger' and its int32_t target, or an 'EmNexReal' and its 
+// display value target, see 'ToValue')
+template<class element_type, class value_type=int32_t>
+class EmNexValueOf: public EmNexPageValue {
+public:
+    EmNexValueOf(const element_type& element, value_type& value)
+     : EmNexPageValue(),
+       m_element(element),
+       m_value(value) {
+        element.Page().AddValue(*this);
+    }
+
+protected:
+    virtual bool _getAsync(EmNexAsyncCallback callback, void* context) override {
+        return m_element.GetValueAsync(m_value, callback, context);
+    }
+
+    virtual uint16_t _readLen() const override {
+        // "get <page>.<element>.val" and number reply (with terminators)
+        return strlen(m_element.PageName()) + strlen(m_element.Name()) + 12 + 8;
+    }
+
+    const element_type& m_element;
+    value_type& m_value;
+};
+
+// Text element value registered to its page 'ReadAll' ('value' 
+// is at least 'len'+1 bytes)
+template<class element_type, size_t len>
+class EmNexTextOf: public EmNexPageValue {
+public:
+    EmNexTextOf(const element_type& element, char* value)
+     : EmNexPageValue(),
+       m_element(element),
+       m_value(value) {
+        element.Page().AddValue(*this);
+    }
+
+protected:
+    virtual bool _getAsync(EmNexAsyncCallback callback, void* context) override {
+        return m_element.template GetValueAsync<len>(m_value, callback, context);
+    }
+
+    virtual uint16_t _readLen() const override {
+        // "get <page>.<element>.txt" and text reply (with terminators)
+        return strlen(m_element.PageName()) + strlen(m_element.Name()) + 12 + len + 4;
+    }
+
+    const element_type& m_element;
+    char* m_value;
+};
+
+// Waveform element: samples are buffered per channel and sent by 
+// 'Flush' with one transparent data transfer for each channel.
+//
+// NOTES:
+//  1. 'AddValue' (producer, e.g. an interrupt handler or another 
+//     core task) and 'Flush' (consumer) can run concurrently: ring 
+//     buffers are lock free for one producer and one consumer
+//  2. with EM_NEX_WAVEFORM_ATOMIC 0 producer and consumer must run 
+//     on the same core (e.g. interrupt handler and main loop)
+//  3. samples exceeding a full channel buffer are discarded
+//  4. waveform must be in current page, samples are kept meanwhile
+template<EmNexPage& page, uint8_t channels, uint8_t size>
+class EmNexWaveform: public EmNexPageElement<page>
+{
+public:
+    static_assert(channels >= 1 && channels <= 4, "Waveforms have 1 to 4 channels");
+    static_assert(size < 0xFF, "Buffer indexes must be written atomically");
+
+    EmNexWaveform(const char* name,
+                  uint8_t componentId,
+                  EmLogLevel logLevel=EmLogLevel::none)
+     : EmNexPageElement<page>(name, logLevel) {
+        this->SetComponentId(componentId);
+        for (uint8_t ch = 0; ch < channels; ch++) {
+            _store(m_head[ch], 0);
+            _store(m_tail[ch], 0);
+        }
+    }
+
+    bool AddValue(uint8_t channel, uint8_t value) {
+        if (channel >= channels) {
+            return false;
+        }
+        uint8_t head = _load(m_head[channel]);
+        uint8_t next = (head + 1) % (size + 1);
+        if (next == _load(m_tail[channel])) {
+            return false;
+        }
+        m_buf[channel][head] = value;
+        _store(m_head[channel], next);
+        return true;
+    }
+
+    // Buffered samples of 'channel'
+    uint8_t Count(uint8_t channel) const {
+        uint8_t head = _load(m_head[channel]);
+        uint8_t tail = _load(m_tail[channel]);
+        return (head >= tail) ? head - tail : size + 1 - tail + head;
+    }
+
+    // Send buffered samples (if waveform page is current)
+    bool Flush() {
+        if (!page.IsCurrent()) {
+            return false;
+        }
+        for (uint8_t ch = 0; ch < channels; ch++) {
+            // Up to two contiguous segments (buffer wraps)
+            for (uint8_t seg = 0; seg < 2; seg++) {
+                uint8_t head = _load(m_head[ch]);
+                uint8_t tail = _load(m_tail[ch]);
+                if (head == tail) {
+                    break;
+                }
+                uint8_t len = (head > tail) ? head - tail : size + 1 - tail;
+                if (!this->Nex().AddWaveformData(this->ComponentId(), 
+                                                 ch, 
+                                                 &m_buf[ch][tail], 
+                                                 len)) {
+                    return false;
+                }
+                _store(m_tail[ch], (tail + len) % (size + 1));
+            }
+        }
+        return true;
+    }
+
+    // Discard buffered samples (consumer side)
+    void Discard() {
+        for (uint8_t ch = 0; ch < channels; ch++) {
+            _store(m_tail[ch], _load(m_head[ch]));
+        }
+    }
+
+protected:
+    // Samples written (read) before an index store are visible to the 
+    // consumer (producer) once it loads the index
+#if EM_NEX_WAVEFORM_ATOMIC
+    typedef std::atomic<uint8_t> index_type;
+
+    static uint8_t _load(const index_type& index) {
+        return index.load(std::memory_order_acquire);
+    }
+
+    static void _store(index_type& index, uint8_t value) {
+        index.store(value, std::memory_order_release);
+    }
+#else
+    typedef volatile uint8_t index_type;
+
+    static uint8_t _load(const index_type& index) {
+        return index;
+    }
+
+    static void _store(index_type& index, uint8_t value) {
+        // Compiler must not move samples accesses after the store
+        __asm__ __volatile__("" ::: "memory");
+        index = value;
+    }
+#endif
+
+    // NOTE: one slot is left free to tell a full buffer from an empty one
+    uint8_t m_buf[channels][size + 1];
+    index_type m_head[channels];
+    index_type m_tail[channels];
+};
+
 template<size_t len>
 inline EmGetValueResult EmNextion::GetTextElementValue(
     const char* pageName, 
@@ -718,6 +2737,7 @@ inline EmGetValueResult EmNextion::GetTextElementValue(
     // (i.e. some bytes might be modified by _recv method!)
     char dispTxt[len+1];
     strncpy(dispTxt, txt, len);
+    dispTxt[len] = 0;
     EmGetValueResult res = EmGetValueResult::failed;
     if (_sendGetCmd(pageName, elementName, "txt")) {
         res = _getString(dispTxt, sizeof(dispTxt), elementName);    
@@ -1,145 +1,533 @@
-#include <stdarg.h>
+#include <string.h>
 
 #include "em_nextion.h"
 #include "em_timeout.h"
 #include "em_defs.h"
 
+// Debug logs are stripped if EM_NEX_DEBUG_LOG is 0: calls are dead 
+// code (i.e. arguments are still "used" but never evaluated)
+#if EM_NEX_DEBUG_LOG
+#define EM_NEX_LOG_DEBUG(len, ...) LogDebug<len>(__VA_ARGS__)
+#define EM_NEX_LOG_DEBUG_F(msg) LogDebug(msg)
+#else
+#define EM_NEX_LOG_DEBUG(len, ...) do { if (0) { LogDebug<len>(__VA_ARGS__); } } while (0)
+#define EM_NEX_LOG_DEBUG_F(msg) do { if (0) { LogDebug(msg); } } while (0)
+#endif
 
-// NOTE: program MUST set "bauds" at first page initialization)
+// Highest command feedback code (i.e. 'bkcmd' return codes)
+static const uint8_t MAX_FEEDBACK_CODE = 0x24;
+
+// Payload length marker of frames ending only by terminators
+static const uint8_t FRAME_VAR_LEN = 0xFF;
+
+// Element reference: "page.element" or just "element" (i.e. current 
+// page element or precomputed path) if page name is not given
+static EmNexCmdBuf& _addElement(EmNexCmdBuf& cmd, 
+                                const char* pageName, 
+                                const char* elementName)
+{
+    if (NULL != pageName) {
+        cmd.Add(pageName).Add('.');
+    }
+    return cmd.Add(elementName);
+}
+
+// Payload length of frames sent by display
+static uint8_t _framePayloadLen(uint8_t code)
+{
+    switch (code) {
+        case EVT_TOUCH: // page, component, event
+            return 3;
+        case EVT_PAGE:
+            return 1;
+        case EVT_TOUCH_XY: // x, y, event
+        case EVT_SLEEP_TOUCH_XY:
+            return 5;
+        case ACK_NUMBER:
+            return 4;
+        case ACK_STRING:
+        case INVALID_CMD: // or startup frame (0x00 0x00 0x00)
+            return FRAME_VAR_LEN;
+        default:
+            return 0;
+    }
+}
+
+// Page commands: display redraws or resets (i.e. slow feedback)
+static bool _isPageCmd(const char* cmd)
+{
+    return 0 == strncmp(cmd, "page ", 5) || 
+           0 == strncmp(cmd, "rest", 4) ||
+           0 == strncmp(cmd, "sendme", 6) ||
+           0 == strncmp(cmd, "ref_star", 8);
+}
+
+// Commands answered by a reply (i.e. not by a feedback)
+static bool _isReplyCmd(const char* cmd)
+{
+    return 0 == strncmp(cmd, "get ", 4) || 
+           0 == strncmp(cmd, "sendme", 6) ||
+           0 == strncmp(cmd, "addt ", 5);
+}
+
+// Latency estimates slot of commands expecting 'code' reply
+static uint8_t _latClass(uint8_t code, bool pageCmd)
+{
+    if (pageCmd) {
+        return 3;
+    }
+    switch (code) {
+        case ACK_NUMBER:
+            return 1;
+        case ACK_STRING:
+            return 2;
+        case ACK_CURRENT_PAGE_ID:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+// NOTE: program MUST set "bauds" at first page initialization 
+//       (or call 'Negotiate')
 EmNextion::EmNextion(EmComSerial& serial, 
                      uint32_t timeoutMs, 
                      EmLogLevel logLevel)
  : EmLog("Nex", logLevel),
    m_Serial(serial),
+   m_BaseTimeoutMs(timeoutMs),
    m_TimeoutMs(timeoutMs),
-   m_IsInit(false)
+   m_Baud(0),
+   m_IsInit(false),
+   m_RxState(rxCode),
+   m_RxCode(0),
+   m_RxLen(0),
+   m_RxTerm(0),
+   m_RxReplayPos(0),
+   m_RxReplayLen(0),
+   m_LastError(ACK_CMD_SUCCEED),
+   m_Pipelined(false),
+   m_CmdCallback(NULL),
+   m_CmdContext(NULL),
+   m_CmdTag(0),
+   m_PendingHead(0),
+   m_PendingCount(0),
+   m_FailedCount(0),
+   m_PendingStartMs(0),
+   m_TxEndMs(0),
+   m_LatValid(0),
+   m_PageCmd(false),
+   m_RxStale(false),
+   m_BatchBuf(NULL),
+   m_BatchSize(0),
+   m_BatchLen(0),
+   m_BatchFailuresOnly(false),
+   m_BatchFailedCount(0),
+   m_BatchAcks(0),
+   m_BatchPrior(0),
+   m_ShadowGen(1),
+   m_CurPage(0),
+   m_CurPageValid(false),
+   m_CurPageReply(0),
+   m_CurPageQuery(pageQueryNone),
+   m_RxPos(0),
+   m_RxChanged(false),
+   m_IdleCallback(NULL),
+   m_IdleContext(NULL),
+   m_Listeners(NULL),
+   m_EventHead(0),
+   m_EventCount(0),
+   m_Dispatching(false),
+   m_Subscriptions(NULL),
+   m_BudgetBps(0),
+   m_BudgetBytes(0),
+   m_BudgetMs(0),
+   m_RefreshStops(0),
+   m_RefreshRestore(false)
 {
+#if EM_NEX_TRACE_SIZE
+    m_TraceHead = 0;
+    m_TraceCount = 0;
+#endif
+#ifdef EM_NEX_STATS
+    ResetStats();
+    m_StatsType = CMD_OTHER;
+#endif
 }
 
 bool EmNextion::Init() const
 {
+    if (m_PendingCount || m_RxStale) {
+        // Late replies of dropped commands would be matched to 
+        // next commands
+        _dropPending();
+        if (!_skipStale()) {
+            return false;
+        }
+    }
     // Have command feedback on both success/fail  
-    _sendCmdParam("bkcmd=3");
-    _sendCmdEnd();
-    m_IsInit = _ack(ACK_CMD_SUCCEED);
+    EmNexCmd<7> cmd;
+    cmd.Add("bkcmd=3");
+    if (!_writeCmd(cmd)) {
+        return false;
+    }
+    // NOTE: init feedback is never pipelined
+    m_IsInit = EmGetValueResult::failed != _recv(ACK_CMD_SUCCEED, NULL, 0);
+    if (m_IsInit && m_RefreshRestore && 0 == m_RefreshStops) {
+        // Refresh suspension outlived its scope
+        m_RefreshRestore = false;
+        EmNexCmd<8> refCmd;
+        refCmd.Add("ref_star");
+        m_RefreshRestore = !(_sendCmd(refCmd) && _ack(ACK_CMD_SUCCEED));
+    }
     return m_IsInit;
 }
 
-bool EmNextion::_sendCmd(const char* firstCmd, ...) const
+bool EmNextion::StopRefresh() const
+{
+    if (m_RefreshStops++) {
+        return true;
+    }
+    EmNexCmd<8> cmd;
+    cmd.Add("ref_stop");
+    return _sendCmd(cmd) && _ack(ACK_CMD_SUCCEED);
+}
+
+bool EmNextion::StartRefresh() const
 {
+    if (0 == m_RefreshStops || --m_RefreshStops) {
+        return true;
+    }
+    EmNexCmd<8> cmd;
+    cmd.Add("ref_star");
+    // NOTE: it is sent even if link was lost meanwhile (i.e. 
+    //       display is initialized again), if it fails display 
+    //       is restored at next 'Init'
+    m_RefreshRestore = !(_sendCmd(cmd) && _ack(ACK_CMD_SUCCEED));
+    return !m_RefreshRestore;
+}
+
+// Nextion bauds, most common first
+static const uint32_t NEX_BAUDS[] = {
+    9600, 115200, 921600, 512000, 256000, 250000, 230400, 
+    57600, 38400, 31250, 19200, 4800, 2400
+};
+
+bool EmNextion::Negotiate(EmNexSetBaudCallback setBaud, 
+                          void* context,
+                          uint32_t maxBaud) const
+{
+    uint32_t curBaud = 0;
+    for (size_t i = 0; i < sizeof(NEX_BAUDS)/sizeof(NEX_BAUDS[0]); i++) {
+        if (_probe(setBaud, context, NEX_BAUDS[i])) {
+            curBaud = NEX_BAUDS[i];
+            break;
+        }
+    }
+    if (0 == curBaud) {
+        EM_NEX_LOG_DEBUG_F(F("Display not found"));
+        return false;
+    }
+
+    uint32_t newBaud = curBaud;
+    for (size_t i = 0; i < sizeof(NEX_BAUDS)/sizeof(NEX_BAUDS[0]); i++) {
+        if (NEX_BAUDS[i] <= maxBaud && NEX_BAUDS[i] > newBaud) {
+            newBaud = NEX_BAUDS[i];
+        }
+    }
+    if (newBaud == curBaud) {
+        return true;
+    }
+
+    // NOTE: display switches right after the command, its 
+    //       feedback (if any) is lost while host switches
+    EmNexCmd<12> cmd;
+    cmd.Add("baud=").AddNumber(static_cast<int32_t>(newBaud));
+    if (!_writeCmd(cmd)) {
+        return false;
+    }
+    m_Serial.flush();
+    _discardRx();
+    if (_probe(setBaud, context, newBaud)) {
+        EM_NEX_LOG_DEBUG(30, "bauds: %lu", static_cast<unsigned long>(newBaud));
+        return true;
+    }
+    // Let's try staying where we were
+    return _probe(setBaud, context, curBaud);
+}
+
+bool EmNextion::_probe(EmNexSetBaudCallback setBaud, 
+                       void* context,
+                       uint32_t baud) const
+{
+    _bResult(false);
+    if (!setBaud(baud, context)) {
+        return false;
+    }
+    m_Baud = baud;
+    ResetLatency();
+    m_TimeoutMs = static_cast<uint32_t>(static_cast<uint64_t>(m_BaseTimeoutMs)*9600/baud);
+    if (m_TimeoutMs < EM_NEX_MIN_TIMEOUT_MS) {
+        m_TimeoutMs = EM_NEX_MIN_TIMEOUT_MS;
+    }
+    // Terminate any partial command display got at wrong bauds
+    _write(EmNexCmdBuf::TERMINATORS, 3);
+    _discardRx();
+    return Init();
+}
+
+void EmNextion::_discardRx() const
+{
+    // Wait for display to settle, skipping whatever it sends
+    EmTimeout rxTimeout(m_TimeoutMs);
+    while (!rxTimeout.IsElapsed(false)) {
+        if (!_readFrame()) {
+            _idle();
+        }
+    }
+    m_RxState = rxCode;
+}
+
+bool EmNextion::_skipStale() const
+{
+    // Display replies in order: late replies come before 'sendme' one.
+    // Terminators first end any partial command left by a garbled 
+    // line (its error feedback is skipped too)
+    EmNexCmd<7> cmd;
+    cmd.Add("sendme");
+    if (!_write(EmNexCmdBuf::TERMINATORS, 3) || 
+        !_writeCmd(cmd)) {
+        return false;
+    }
+    EmTimeout rxTimeout(m_TimeoutMs);
+    while (!rxTimeout.IsElapsed(false)) {
+        if (!_readFrame()) {
+            _idle();
+            continue;
+        }
+        if (ACK_CURRENT_PAGE_ID == m_RxCode) {
+            m_RxStale = false;
+            return true;
+        }
+        if (!_isFeedback()) {
+            // Display events are kept
+            _processFrame();
+        }
+        rxTimeout.Restart();
+    }
+    return false;
+}
+
+bool EmNextion::_sendCmd(const char* cmd) const
+{
+    EmNexCmd<EM_NEX_MAX_CMD_LEN> nexCmd;
+    nexCmd.Add(cmd);
+    return _sendCmd(nexCmd);
+}
+
+bool EmNextion::_sendCmd(EmNexCmdBuf& cmd) const
+{
+    if (!cmd.IsValid()) {
+        EM_NEX_LOG_DEBUG(50, "TX: command too long [%s...]", cmd.Data());
+        return false;
+    }
     // Before sending let's see if display is active/connected
     if (!m_IsInit && !Init()) {
         return false;
     }
-    m_Serial.flush();
-    _sendCmdParam(firstCmd);
-    va_list args;
-    va_start(args, firstCmd);     
-    const char* cmdParam = va_arg(args, const char*);
-    while (cmdParam) {
-        _sendCmdParam(cmdParam);
-        cmdParam = va_arg(args, const char*);
+    cmd.End();
+    if (IsBatch()) {
+        if (m_BatchFailuresOnly && _isReplyCmd(cmd.Data()) && !_endFailuresOnly()) {
+            return false;
+        }
+        // Record the command
+        m_PageCmd = _isPageCmd(cmd.Data());
+        _statsCmd(cmd.Data(), cmd.Len());
+        return _batchAppend(cmd.Data(), cmd.Len());
     }
-    va_end(args);
+    return _writeCmd(cmd);
+}
 
-    return _sendCmdEnd();
+bool EmNextion::_sendCmd(EmNexCmdBuf& head, 
+                         EmNexTextSource& text, 
+                         const char* tail) const
+{
+    // Before sending let's see if display is active/connected
+    if (!m_IsInit && !Init()) {
+        return false;
+    }
+    bool batch = IsBatch();
+    // Text chunks are written as they come
+    const char* chunk = NULL;
+    uint16_t chunkLen = head.Len();
+    m_PageCmd = false;
+    _statsCmd(head.Data(), chunkLen);
+    bool res = batch ? _batchAppend(head.Data(), chunkLen) : 
+                       _write(head.Data(), chunkLen);
+    while (res && 0 != (chunkLen = text.NextChunk(chunk))) {
+        _statsTx(chunkLen);
+        res = batch ? _batchAppend(chunk, chunkLen) : 
+                      _write(chunk, chunkLen);
+    }
+    uint16_t tailLen = strlen(tail);
+    _statsTx(tailLen + 3);
+    if (batch) {
+        return res &&
+               _batchAppend(tail, tailLen) &&
+               _batchAppend(EmNexCmdBuf::TERMINATORS, 3);
+    }
+    return res &&
+           _write(tail, tailLen) &&
+           _write(EmNexCmdBuf::TERMINATORS, 3);
 }
 
-bool EmNextion::_sendCmdParam(const char* cmdParam) const
+bool EmNextion::_writeCmd(EmNexCmdBuf& cmd) const
 {
-    return _bResult(m_Serial.write(cmdParam) > 0);
+    cmd.End();
+    m_PageCmd = _isPageCmd(cmd.Data());
+    _statsCmd(cmd.Data(), cmd.Len());
+    return _write(cmd.Data(), cmd.Len());
 }
 
-bool EmNextion::_sendCmdEnd() const
+bool EmNextion::_write(const char* data, uint16_t len) const
 {
-    m_Serial.write(0xFF);
-    m_Serial.write(0xFF);
-    return _bResult(m_Serial.write(0xFF) == 1);
+    // Data may still be on its way when write returns (i.e. buffered)
+    uint32_t now = millis();
+    if (static_cast<int32_t>(m_TxEndMs - now) < 0) {
+        m_TxEndMs = now;
+    }
+    // NOTE: rounded up, many short writes must not add up to less 
+    //       than their transfer time
+    uint32_t baud = (0 != m_Baud) ? m_Baud : 9600;
+    m_TxEndMs += (static_cast<uint32_t>(len)*10000 + baud - 1)/baud;
+    _trace(TRACE_TX, 0, len);
+    return _bResult(m_Serial.write(reinterpret_cast<const uint8_t*>(data), 
+                                   len) == len);
 }
 
+
+
 EmGetValueResult EmNextion::_recv(uint8_t ackCode, 
                                   char* buf, 
-                                  uint8_t len, 
+                                  uint16_t len, 
                                   bool isText) const
 {
-    bool value_changed = false;
-    bool got_ackCode=false;
-    bool got_buffer=(len==0);
-    uint8_t term_count=0;
-    uint8_t buf_pos=0;
-    EmTimeout rxTimeout(m_TimeoutMs);
-    while (!rxTimeout.IsElapsed(false)) {
-        while (m_Serial.available()) {
-            uint8_t c = static_cast<uint8_t>(m_Serial.read());
-            // Still waiting for ack code?
-            if (!got_ackCode) {
-                got_ackCode = (c==ackCode);
-            }
-            // Still waiting for data?
-            else if (!got_buffer) {
-                if (isText && c == 0xFF) {
-                    buf[buf_pos] = 0;
-                    got_buffer = true;    
-                    term_count = 1;
-                } else {
-                    if (buf[buf_pos] != c) {
-                        // We might have reached text buffer size 
-                        if (!(isText && buf_pos==len-1)) {
-                            value_changed = true;
-                        }
-                    }
-                    buf[buf_pos++] = static_cast<char>(c);
-                    got_buffer = (buf_pos==len);
-                }
-            }
-            // Still waiting for terminators!
-            else {
-                if (c != 0xFF) {
-                    if (isText) {
-                        // We might have reached text buffer 
-                        // size but not all display text!
-                        buf[buf_pos] = 0;
-                        continue;
-                    }
-                    return _result(false, value_changed);
-                }
-                term_count++;
-                if (term_count>=3) {
-                    // Got everything
-                    return _result(true, value_changed);
-                }
-            }
+    // Batched commands have to be sent before waiting this reply
+    if (m_BatchLen) {
+        _flushBatch();
+    }
+    // Blocking wrapper of the receive state machine: the reply is 
+    // queued after pending commands and the parser is driven until 
+    // it gets completed (pending timeout drops it on link failure)
+    WaitSlot slot = { EmGetValueResult::failed, true };
+    if (!_pushPending(ackCode, buf, len, _waitDone, &slot)) {
+        return EmGetValueResult::failed;
+    }
+    while (slot.waiting) {
+        if (!_pollFrame()) {
+            _idle();
         }
     }
-    LogDebug<50>("RX: %s [Timeout elapsed!]", buf);
-    return _result(false, value_changed);
+    if (EmGetValueResult::failed == slot.result) {
+        EM_NEX_LOG_DEBUG(50, "RX: 0x%02X %s[failed]", ackCode, isText ? "(text) " : "");
+    }
+    return slot.result;
 }
 
-EmGetValueResult EmNextion::_result(bool result, bool valueChanged) const
-{ 
-    if (!result) { 
-        m_IsInit = false;
-        return EmGetValueResult::failed;
+void EmNextion::_waitDone(EmGetValueResult result, void* context)
+{
+    WaitSlot* slot = static_cast<WaitSlot*>(context);
+    slot->result = result;
+    slot->waiting = false;
+}
+
+
+void EmNextion::_rxText(char* buf, uint16_t len, uint8_t c) const
+{
+    if (SINK_LEN == len) {
+        if (reinterpret_cast<EmNexTextSink*>(buf)->Put(m_RxPos++, static_cast<char>(c))) {
+            m_RxChanged = true;
+        }
+        return;
+    }
+    // Last byte is the string terminator, exceeding text is discarded
+    if (m_RxPos+1 < len) {
+        if (buf[m_RxPos] != static_cast<char>(c)) {
+            m_RxChanged = true;
+        }
+        buf[m_RxPos++] = static_cast<char>(c);
+    }
+}
+
+void EmNextion::_rxReply(char* buf, uint16_t len) const
+{
+    if (ACK_STRING == m_RxCode) {
+        if (SINK_LEN == len) {
+            if (reinterpret_cast<EmNexTextSink*>(buf)->End(m_RxPos)) {
+                m_RxChanged = true;
+            }
+        } else if (len) {
+            // Previous text might be longer 
+            if (0 != buf[m_RxPos]) {
+                m_RxChanged = true;
+            }
+            buf[m_RxPos] = 0;
+        }
+        return;
+    }
+    // NOTE: numbers are little endian (i.e. as Nextion ones) and 
+    //       smaller variables get the lower bytes
+    for (uint8_t i=0; i < len && i < m_RxLen; i++) {
+        if (buf[i] != static_cast<char>(m_RxPayload[i])) {
+            m_RxChanged = true;
+        }
+        buf[i] = static_cast<char>(m_RxPayload[i]);
     }
-    return valueChanged ? 
-           EmGetValueResult::succeedNotEqualValue : 
-           EmGetValueResult::succeedEqualValue;
 }
 
 bool EmNextion::_bResult(bool result) const
 { 
     if (!result) { 
+        if (m_IsInit) {
+            _trace(TRACE_LINK_LOST, 0);
+#ifdef EM_NEX_STATS
+            m_Stats.initResets++;
+#endif
+        }
         m_IsInit = false;
+        _dropPending();
+        _invalidateCache();
     }
     return result;
 }
 
 bool EmNextion::_ack(uint8_t ackCode) const 
 {
-    LogDebug(F("Waiting ACK"));
+    if (ACK_CMD_SUCCEED == ackCode && (m_Pipelined || IsBatch())) {
+        return _ackAsync(NULL, NULL);
+    }
+    EM_NEX_LOG_DEBUG_F(F("Waiting ACK"));
     return EmGetValueResult::failed != _recv(ackCode, NULL, 0);
 }
 
+bool EmNextion::_ackAsync(EmNexAsyncCallback callback, 
+                          void* context) const 
+{
+    if (IsBatch()) {
+        // Only failures are notified within 'failuresOnly' batches
+        if (m_BatchFailuresOnly) {
+            return true;
+        }
+        if (NULL == callback) {
+            // Queued once the batch is written (see '_queueBatchAcks')
+            m_BatchAcks++;
+            m_CmdTag++;
+            return true;
+        }
+    }
+    return _pushPending(ACK_CMD_SUCCEED, NULL, 0, callback, context);
+}
+
 bool EmNextion::IsCurPage(uint8_t pageId) const {
     uint8_t id;
     return GetCurPage(id) && id == pageId;
@@ -147,28 +535,89 @@ bool EmNextion::IsCurPage(uint8_t pageId) const {
 
 bool EmNextion::GetCurPage(uint8_t& pageId) const 
 {
-    if (!_sendCmd("sendme", NULL)) {
+    // Collect page changes notified by display
+    _pollFrames();
+    if (!m_CurPageValid) {
+        return RefreshCurPage(pageId);
+    }
+    pageId = m_CurPage;
+    return true;
+}
+
+bool EmNextion::RefreshCurPage(uint8_t& pageId) const 
+{
+    if (!_sendCmd("sendme")) {
         return false;
     }
-    if (EmGetValueResult::failed != _recv(ACK_CURRENT_PAGE_ID, 
-                                         (char*)&pageId, 1)) {
+    if (EmGetValueResult::failed == _recv(ACK_CURRENT_PAGE_ID, 
+                                          (char*)&m_CurPage, 1)) {
+        return false;
+    }
+    m_CurPageValid = true;
+    pageId = m_CurPage;
+    return true;
+}
+
+bool EmNextion::_refreshCurPageAsync() const
+{
+    // One query at a time: page is known once its reply is processed
+    if (pageQueryNone != m_CurPageQuery) {
         return true;
     }
-    return false;
+    if (!_sendCmd("sendme") ||
+        !_pushPending(ACK_CURRENT_PAGE_ID, (char*)&m_CurPageReply, 1, 
+                      _curPageDone, const_cast<EmNextion*>(this))) {
+        return false;
+    }
+    m_CurPageQuery = pageQueryPending;
+    return true;
+}
+
+void EmNextion::_curPageDone(EmGetValueResult result, void* context)
+{
+    const EmNextion* nex = static_cast<const EmNextion*>(context);
+    // Page changed meanwhile (e.g. 'SetCurPage' by page name)
+    if (pageQueryPending == nex->m_CurPageQuery && 
+        EmGetValueResult::failed != result) {
+        nex->m_CurPage = nex->m_CurPageReply;
+        nex->m_CurPageValid = true;
+    }
+    nex->m_CurPageQuery = pageQueryNone;
+}
+
+void EmNextion::_invalidateCurPage() const
+{
+    m_CurPageValid = false;
+    if (pageQueryPending == m_CurPageQuery) {
+        m_CurPageQuery = pageQueryStale;
+    }
 }
 
 bool EmNextion::SetCurPage(uint8_t pageId) const 
 {
-    char buf[3];
-    if (!_sendCmd("page ", to_str(buf, 3, pageId), NULL)) {
+    // Display resets elements attributes on page change
+    InvalidateShadows();
+    _invalidateCurPage();
+    EmNexCmd<8> cmd;
+    cmd.Add("page ").AddNumber(pageId);
+    if (!_sendCmd(cmd) || 
+        !_ack(ACK_CMD_SUCCEED)) {
         return false;
     }
-    return _ack(ACK_CMD_SUCCEED);
+    m_CurPage = pageId;
+    m_CurPageValid = true;
+    return true;
 }
 
 bool EmNextion::SetCurPage(const char* pageName) const 
 {
-    if (!_sendCmd("page ", pageName, NULL)) {
+    // Display resets elements attributes on page change
+    // (page id is unknown until next 'RefreshCurPage' call)
+    InvalidateShadows();
+    _invalidateCurPage();
+    EmNexCmd<EM_NEX_MAX_CMD_LEN> cmd;
+    cmd.Add("page ").Add(pageName);
+    if (!_sendCmd(cmd)) {
         return false;
     }
     return _ack(ACK_CMD_SUCCEED);
@@ -182,12 +631,12 @@ EmGetValueResult EmNextion::GetNumElementValue(const char* pageName,
     if (_sendGetCmd(pageName, elementName, "val")) {
         res = _getNumber(val);
     }
-    LogDebug<50>("get: %s -> %d [%s]", 
+    EM_NEX_LOG_DEBUG(50, "get: %s -> %ld [%s]", 
                  elementName,
-                 val,
+                 static_cast<long>(val),
                  (EmGetValueResult::failed != res ? 
-                  " [SUCCESS]" : 
-                  " [FAIL]"));
+                  "SUCCESS" : 
+                  "FAIL"));
     return res;
 }
 
@@ -198,10 +647,10 @@ bool EmNextion::SetNumElementValue(const char* pageName,
     if (_sendSetCmd(pageName, elementName, "val", val)) {
         res = _ack(ACK_CMD_SUCCEED);
     }
-    LogDebug<50>("set: %s -> %d [%s]", 
+    EM_NEX_LOG_DEBUG(50, "set: %s -> %ld [%s]", 
                  elementName,
-                 val,
-                 (res ? " [SUCCESS]" : " [FAIL]"));
+                 static_cast<long>(val),
+                 (res ? "SUCCESS" : "FAIL"));
     return res;
 }
 
@@ -212,23 +661,126 @@ bool EmNextion::SetTextElementValue(const char* pageName,
     if (_sendSetCmd(pageName, elementName, "txt", txt)) {
         res = _ack(ACK_CMD_SUCCEED);
     }
-    LogDebug<50>("set: %s -> %s [%s]", 
+    EM_NEX_LOG_DEBUG(50, "set: %s -> %s [%s]", 
+                 elementName,
+                 txt,
+                 (res ? "SUCCESS" : "FAIL"));
+    return res;
+}
+
+bool EmNextion::AppendTextElementValue(const char* pageName, 
+                                       const char* elementName, 
+                                       const char* txt) const {
+    bool res = false;
+    // NOTE: "txt+" property makes a 'txt+="..."' command
+    if (_sendSetCmd(pageName, elementName, "txt+", txt)) {
+        res = _ack(ACK_CMD_SUCCEED);
+    }
+    EM_NEX_LOG_DEBUG(50, "append: %s -> %s [%s]", 
                  elementName,
                  txt,
-                 (res ? " [SUCCESS]" : " [FAIL]"));
+                 (res ? "SUCCESS" : "FAIL"));
+    return res;
+}
+
+bool EmNextion::SubTextElementValue(const char* pageName, 
+                                    const char* elementName, 
+                                    uint16_t start,
+                                    uint16_t len) const {
+    bool res = false;
+    EmNexCmd<EM_NEX_MAX_CMD_LEN> cmd;
+    cmd.Add("substr ");
+    _addElement(cmd, pageName, elementName).Add(".txt,");
+    _addElement(cmd, pageName, elementName).Add(".txt,");
+    cmd.AddNumber(start).Add(',').AddNumber(len);
+    if (_sendCmd(cmd)) {
+        res = _ack(ACK_CMD_SUCCEED);
+    }
+    EM_NEX_LOG_DEBUG(50, "substr: %s -> %u,%u [%s]", 
+                 elementName,
+                 start,
+                 len,
+                 (res ? "SUCCESS" : "FAIL"));
+    return res;
+}
+
+bool EmNextion::AddWaveformValue(uint8_t componentId, 
+                                 uint8_t channel, 
+                                 uint8_t value) const {
+    bool res = false;
+    EmNexCmd<16> cmd;
+    cmd.Add("add ").AddNumber(componentId).Add(',').AddNumber(channel).Add(',').AddNumber(value);
+    if (_sendCmd(cmd)) {
+        res = _ack(ACK_CMD_SUCCEED);
+    }
+    return res;
+}
+
+bool EmNextion::AddWaveformData(uint8_t componentId, 
+                                uint8_t channel, 
+                                const uint8_t* data,
+                                uint16_t len) const {
+    EmNexCmd<20> cmd;
+    cmd.Add("addt ").AddNumber(componentId).Add(',').AddNumber(channel).Add(',').AddNumber(len);
+    // Display enters transparent mode and tells when it is ready, 
+    // then it takes 'len' raw bytes (0xFF included) and confirms
+    // NOTE: completion wait gets 'len' to account data transfer time
+    bool res = _sendCmd(cmd) &&
+               EmGetValueResult::failed != _recv(ACK_TRANSPARENT_READY, NULL, 0);
+    if (res) {
+        _statsTx(len);
+        res = _write(reinterpret_cast<const char*>(data), len) &&
+              EmGetValueResult::failed != _recv(ACK_TRANSPARENT_DONE, NULL, len);
+    }
+    EM_NEX_LOG_DEBUG(50, "addt: %u,%u,%u [%s]", 
+                 componentId,
+                 channel,
+                 len,
+                 (res ? "SUCCESS" : "FAIL"));
+    return res;
+}
+
+EmGetValueResult EmNextion::GetTextElementValue(const char* pageName, 
+                                                const char* elementName, 
+                                                EmNexTextSink& sink) const
+{
+    EmGetValueResult res = EmGetValueResult::failed;
+    if (_sendGetCmd(pageName, elementName, "txt")) {
+        res = _recv(ACK_STRING, reinterpret_cast<char*>(&sink), SINK_LEN, true);
+    }
+    EM_NEX_LOG_DEBUG(50, "get: %s -> (stream) [%s]", 
+                 elementName,
+                 (EmGetValueResult::failed != res ? 
+                  "SUCCESS" : 
+                  "FAIL"));
+    return res;
+}
+
+bool EmNextion::SetTextElementValue(const char* pageName, 
+                                    const char* elementName, 
+                                    EmNexTextSource& source) const {
+    bool res = false;
+    if (_sendSetCmd(pageName, elementName, "txt", source)) {
+        res = _ack(ACK_CMD_SUCCEED);
+    }
+    EM_NEX_LOG_DEBUG(50, "set: %s -> (stream) [%s]", 
+                 elementName,
+                 (res ? "SUCCESS" : "FAIL"));
     return res;
 }
 
 bool EmNextion::SetVisible(const char* elementName, 
                            bool visible) const {
     bool res = false;
-    if (_sendCmd("vis ", elementName, visible ? ",1" : ",0", NULL)) {
+    EmNexCmd<EM_NEX_MAX_CMD_LEN> cmd;
+    cmd.Add("vis ").Add(elementName).Add(visible ? ",1" : ",0");
+    if (_sendCmd(cmd)) {
         res = _ack(ACK_CMD_SUCCEED);
     }
-    LogDebug<50>("visible: %s -> %s [%s]", 
+    EM_NEX_LOG_DEBUG(50, "visible: %s -> %u [%s]", 
                  elementName,
                  visible,
-                 (res ? " [SUCCESS]" : " [FAIL]"));
+                 (res ? "SUCCESS" : "FAIL"));
     return res;
 }
 
@@ -245,10 +797,10 @@ bool EmNextion::SetPicture(const char* pageName,
     if (_sendSetCmd(pageName, elementName, "pic", picId)) {
         res = _ack(ACK_CMD_SUCCEED);
     }
-    LogDebug<50>("pic: %s -> %s [%s]", 
+    EM_NEX_LOG_DEBUG(50, "pic: %s -> %u [%s]", 
                  elementName,
                  picId,
-                 (res ? " [SUCCESS]" : " [FAIL]"));
+                 (res ? "SUCCESS" : "FAIL"));
     return res;
 }
 
@@ -256,30 +808,32 @@ bool EmNextion::GetPicture(const char* pageName,
                            const char* elementName, 
                            uint8_t& picId) const {
     bool res = false;
-    if (_sendGetCmd(pageName, elementName, "val")) {
-        int32_t val;
+    if (_sendGetCmd(pageName, elementName, "pic")) {
+        int32_t val = 0;
         res = _getNumber(val) != EmGetValueResult::failed;
         if (res) {
             picId = static_cast<uint8_t>(val);
         }
     }
-    LogDebug<50>("pic: %s -> %d [%s]", 
+    EM_NEX_LOG_DEBUG(50, "pic: %s -> %u [%s]", 
                  elementName,
                  picId,
-                 res ? " [SUCCESS]" : " [FAIL]");
+                 res ? "SUCCESS" : "FAIL");
     return res;
 }
 
 bool EmNextion::Click(const char* elementName, 
                       bool pressed) const {
     bool res = false;
-    if (_sendCmd("click ", elementName, pressed ? ",1" : ",0", NULL)) {
+    EmNexCmd<EM_NEX_MAX_CMD_LEN> cmd;
+    cmd.Add("click ").Add(elementName).Add(pressed ? ",1" : ",0");
+    if (_sendCmd(cmd)) {
         res = _ack(ACK_CMD_SUCCEED);
     }
-    LogDebug<50>("click: %s -> %s [%s]", 
+    EM_NEX_LOG_DEBUG(50, "click: %s -> %u [%s]", 
                  elementName,
                  pressed,
-                 (res ? " [SUCCESS]" : " [FAIL]"));
+                 (res ? "SUCCESS" : "FAIL"));
     return res;
 }
 
@@ -298,11 +852,11 @@ bool EmNextion::_setColor(const char* pageName,
     if (_sendSetCmd(pageName, elementName, colorCode, color565)) {
         res = _ack(ACK_CMD_SUCCEED);
     }
-    LogDebug<50>("%s: %s -> %s [%s]", 
+    EM_NEX_LOG_DEBUG(50, "%s: %s -> %u [%s]", 
                  colorCode,
                  elementName,
                  color565,
-                 (res ? " [SUCCESS]" : " [FAIL]"));
+                 (res ? "SUCCESS" : "FAIL"));
     return res;
 }
 
@@ -312,28 +866,157 @@ bool EmNextion::_getColor(const char* pageName,
                           uint16_t& color565) const {
     bool res = false;
     if (_sendGetCmd(pageName, elementName, colorCode)) {
-        int32_t val;
+        int32_t val = 0;
         res = _getNumber(val) != EmGetValueResult::failed;
         if (res) {
             color565 = static_cast<uint16_t>(val);
         }
     }
-    LogDebug<50>("%s: %s -> %s [%s]", 
+    EM_NEX_LOG_DEBUG(50, "%s: %s -> %u [%s]", 
                  colorCode,
                  elementName,
                  color565,
-                 (res ? " [SUCCESS]" : " [FAIL]"));
+                 (res ? "SUCCESS" : "FAIL"));
     return res;
 }
 
+bool EmNextion::GetNumElementValueAsync(const char* pageName, 
+                                        const char* elementName, 
+                                        int32_t& val,
+                                        EmNexAsyncCallback callback,
+                                        void* context) const
+{
+    return _sendGetCmd(pageName, elementName, "val") &&
+           _pushPending(ACK_NUMBER, (char*)&val, sizeof(val), callback, context);
+}
+
+bool EmNextion::GetTextElementValueAsync(const char* pageName, 
+                                         const char* elementName, 
+                                         char* txt,
+                                         uint16_t bufLen,
+                                         EmNexAsyncCallback callback,
+                                         void* context) const
+{
+    return _sendGetCmd(pageName, elementName, "txt") &&
+           _pushPending(ACK_STRING, txt, bufLen, callback, context);
+}
+
+bool EmNextion::GetTextElementValueAsync(const char* pageName, 
+                                         const char* elementName, 
+                                         EmNexTextSink& sink,
+                                         EmNexAsyncCallback callback,
+                                         void* context) const
+{
+    return _sendGetCmd(pageName, elementName, "txt") &&
+           _pushPending(ACK_STRING, reinterpret_cast<char*>(&sink), SINK_LEN, callback, context);
+}
+
+bool EmNextion::GetPictureAsync(const char* pageName, 
+                                const char* elementName, 
+                                uint8_t& picId,
+                                EmNexAsyncCallback callback,
+                                void* context) const
+{
+    return _sendGetCmd(pageName, elementName, "pic") &&
+           _pushPending(ACK_NUMBER, (char*)&picId, sizeof(picId), callback, context);
+}
+
+bool EmNextion::_getColorAsync(const char* pageName, 
+                               const char* elementName, 
+                               const char* colorCode, 
+                               uint16_t& color565,
+                               EmNexAsyncCallback callback,
+                               void* context) const
+{
+    return _sendGetCmd(pageName, elementName, colorCode) &&
+           _pushPending(ACK_NUMBER, (char*)&color565, sizeof(color565), callback, context);
+}
+
+bool EmNextion::SetNumElementValueAsync(const char* pageName, 
+                                        const char* elementName, 
+                                        int32_t val,
+                                        EmNexAsyncCallback callback,
+                                        void* context) const
+{
+    return _sendSetCmd(pageName, elementName, "val", val) &&
+           _ackAsync(callback, context);
+}
+
+bool EmNextion::SetTextElementValueAsync(const char* pageName, 
+                                         const char* elementName, 
+                                         const char* txt,
+                                         EmNexAsyncCallback callback,
+                                         void* context) const
+{
+    return _sendSetCmd(pageName, elementName, "txt", txt) &&
+           _ackAsync(callback, context);
+}
+
+bool EmNextion::SetTextElementValueAsync(const char* pageName, 
+                                         const char* elementName, 
+                                         EmNexTextSource& source,
+                                         EmNexAsyncCallback callback,
+                                         void* context) const
+{
+    return _sendSetCmd(pageName, elementName, "txt", source) &&
+           _ackAsync(callback, context);
+}
+
+bool EmNextion::SetPictureAsync(const char* pageName, 
+                                const char* elementName, 
+                                uint8_t picId,
+                                EmNexAsyncCallback callback,
+                                void* context) const
+{
+    return _sendSetCmd(pageName, elementName, "pic", picId) &&
+           _ackAsync(callback, context);
+}
+
+bool EmNextion::_setColorAsync(const char* pageName, 
+                               const char* elementName, 
+                               const char* colorCode, 
+                               uint16_t color565,
+                               EmNexAsyncCallback callback,
+                               void* context) const
+{
+    return _sendSetCmd(pageName, elementName, colorCode, color565) &&
+           _ackAsync(callback, context);
+}
+
+bool EmNextion::SetVisibleAsync(uint8_t pageId, 
+                                const char* elementName, 
+                                bool visible,
+                                EmNexAsyncCallback callback,
+                                void* context) const
+{
+    EmNexCmd<EM_NEX_MAX_CMD_LEN> cmd;
+    cmd.Add("vis ").Add(elementName).Add(visible ? ",1" : ",0");
+    return IsCurPage(pageId) &&
+           _sendCmd(cmd) &&
+           _ackAsync(callback, context);
+}
+
+bool EmNextion::ClickAsync(uint8_t pageId, 
+                           const char* elementName, 
+                           bool pressed,
+                           EmNexAsyncCallback callback,
+                           void* context) const
+{
+    EmNexCmd<EM_NEX_MAX_CMD_LEN> cmd;
+    cmd.Add("click ").Add(elementName).Add(pressed ? ",1" : ",0");
+    return IsCurPage(pageId) &&
+           _sendCmd(cmd) &&
+           _ackAsync(callback, context);
+}
+
 bool EmNextion::_sendGetCmd(const char* pageName, 
-                  const char* elementName, 
-                  const char* property) const
+                             const char* elementName, 
+                             const char* property) const
 {
-    return _sendCmd("get ", 
-                    pageName, ".", 
-                    elementName, ".",
-                    property, NULL);
+    EmNexCmd<EM_NEX_MAX_CMD_LEN> cmd;
+    cmd.Add("get ");
+    _addElement(cmd, pageName, elementName).Add('.').Add(property);
+    return _sendCmd(cmd);
 }
 
 bool EmNextion::_sendSetCmd(const char* pageName, 
@@ -341,11 +1024,9 @@ bool EmNextion::_sendSetCmd(const char* pageName,
                             const char* property, 
                             int32_t value) const
 {
-    char buf[11];
-    return _sendCmd(pageName, ".", 
-                    elementName, ".",
-                    property, "=",
-                    to_str(buf, 11, value), NULL);
+    EmNexCmd<EM_NEX_MAX_CMD_LEN> cmd;
+    _addElement(cmd, pageName, elementName).Add('.').Add(property).Add('=').AddNumber(value);
+    return _sendCmd(cmd);
 }
 
 bool EmNextion::_sendSetCmd(const char* pageName, 
@@ -353,10 +1034,33 @@ bool EmNextion::_sendSetCmd(const char* pageName,
                             const char* property, 
                             const char* value) const
 {
-    return _sendCmd(pageName, ".", 
-                    elementName, ".",
-                    property, "=",
-                    "\"", value, "\"", NULL);
+    EmNexCmd<EM_NEX_MAX_CMD_LEN> cmd;
+    _addElement(cmd, pageName, elementName).Add('.').Add(property).Add("=\"");
+    if (cmd.IsValid()) {
+        uint16_t headLen = cmd.Len();
+        cmd.Add(value).Add('"');
+        if (!cmd.IsValid()) {
+            // Text is too long to be assembled: it is written apart
+            cmd.Resize(headLen);
+            EmNexStringSource source(value);
+            return _sendCmd(cmd, source, "\"");
+        }
+    }
+    return _sendCmd(cmd);
+}
+
+bool EmNextion::_sendSetCmd(const char* pageName, 
+                            const char* elementName, 
+                            const char* property, 
+                            EmNexTextSource& value) const
+{
+    EmNexCmd<EM_NEX_MAX_CMD_LEN> cmd;
+    _addElement(cmd, pageName, elementName).Add('.').Add(property).Add("=\"");
+    if (!cmd.IsValid()) {
+        EM_NEX_LOG_DEBUG(50, "TX: command too long [%s...]", cmd.Data());
+        return false;
+    }
+    return _sendCmd(cmd, value, "\"");
 }
 
 
@@ -375,7 +1079,7 @@ EmGetValueResult EmNextion::_getNumber(int32_t& val) const
 }
 
 EmGetValueResult EmNextion::_getString(char* txt, 
-                                       uint8_t bufLen, 
+                                       uint16_t bufLen, 
                                        const char* elementName) const  
 {
     EmGetValueResult res = _recv(ACK_STRING, txt, bufLen, true);
@@ -384,11 +1088,849 @@ EmGetValueResult EmNextion::_getString(char* txt,
     } else { 
         txt[bufLen-1]=0;
     } 
-    LogDebug<50>("get: %s -> %s [%s]", 
+    EM_NEX_LOG_DEBUG(50, "get: %s -> %s [%s]", 
                  elementName,
                  txt,
                  (EmGetValueResult::failed != res ? 
-                  " [SUCCESS]" : 
-                  " [FAIL]"));
+                  "SUCCESS" : 
+                  "FAIL"));
     return res;
 }
+
+void EmNextion::SetIdleCallback(EmNexIdleCallback callback, 
+                                void* context) const
+{
+    m_IdleCallback = callback;
+    m_IdleContext = context;
+}
+
+void EmNextion::_idle() const
+{
+    if (NULL != m_IdleCallback) {
+        m_IdleCallback(m_IdleContext);
+    }
+}
+
+void EmNextion::SetPipelined(bool pipelined, 
+                             EmNexCmdCallback callback, 
+                             void* context) const
+{
+    if (!pipelined) {
+        WaitPending();
+    }
+    m_Pipelined = pipelined;
+    m_CmdCallback = callback;
+    m_CmdContext = context;
+}
+
+void EmNextion::Poll() const
+{
+    _pollFrames();
+    // Listeners are called only here so that they can use any method
+    if (!m_Dispatching) {
+        m_Dispatching = true;
+        _dispatchEvents();
+        _dispatchChanges();
+        _schedule();
+        m_Dispatching = false;
+    }
+}
+
+void EmNextion::Subscribe(EmNexSubscription& subscription) const
+{
+    subscription.m_dueMs = millis();
+    subscription.m_next = m_Subscriptions;
+    m_Subscriptions = &subscription;
+}
+
+void EmNextion::Unsubscribe(EmNexSubscription& subscription) const
+{
+    // NOTE: a read in progress still completes (its target 
+    //       must be valid until then)
+    EmNexSubscription** next = &m_Subscriptions;
+    while (NULL != *next) {
+        if (*next == &subscription) {
+            *next = subscription.m_next;
+            subscription.m_next = NULL;
+            return;
+        }
+        next = &(*next)->m_next;
+    }
+}
+
+void EmNextion::SetReadBudget(uint16_t bytesPerSecond) const
+{
+    m_BudgetBps = bytesPerSecond;
+    m_BudgetBytes = 0;
+    m_BudgetMs = millis();
+}
+
+void EmNextion::_schedule() const
+{
+    // NOTE: no reads while link is lost (sending would call the 
+    //       blocking 'Init', reconnecting is up to the application)
+    if (NULL == m_Subscriptions || IsBatch() || !m_IsInit) {
+        return;
+    }
+    uint32_t now = millis();
+    if (m_BudgetBps) {
+        // Token bucket: up to a quarter of second of reads in a row
+        int32_t earned = static_cast<int32_t>((now - m_BudgetMs)*m_BudgetBps/1000);
+        if (earned > 0) {
+            m_BudgetBytes += earned;
+            m_BudgetMs = now;
+        }
+        if (m_BudgetBytes > m_BudgetBps/4) {
+            m_BudgetBytes = m_BudgetBps/4;
+        }
+    }
+    if (!m_CurPageValid && m_PendingCount < EM_NEX_MAX_PENDING/2) {
+        // Current page is queried without waiting its reply (i.e. 
+        // 'Poll' never blocks)
+        _refreshCurPageAsync();
+    }
+    // Leave room in the pending queue for other commands
+    while (m_PendingCount < EM_NEX_MAX_PENDING/2 && 
+           (0 == m_BudgetBps || m_BudgetBytes > 0)) {
+        EmNexSubscription* best = NULL;
+        for (EmNexSubscription* sub = m_Subscriptions; NULL != sub; sub = sub->m_next) {
+            if (sub->m_busy || static_cast<int32_t>(now - sub->m_dueMs) < 0) {
+                continue;
+            }
+            // Page values wait until current page is known
+            if (NULL != sub->m_value.m_page && !m_CurPageValid) {
+                continue;
+            }
+            if (NULL == best || 
+                sub->m_priority > best->m_priority ||
+                (sub->m_priority == best->m_priority && 
+                 static_cast<int32_t>(sub->m_dueMs - best->m_dueMs) < 0)) {
+                best = sub;
+            }
+        }
+        if (NULL == best) {
+            return;
+        }
+        // Next read (late reads are not caught up)
+        best->m_dueMs += best->m_periodMs;
+        if (static_cast<int32_t>(now - best->m_dueMs) >= 0) {
+            best->m_dueMs = now + best->m_periodMs;
+        }
+        const EmNexPage* page = best->m_value.m_page;
+        if (NULL != page && (!m_CurPageValid || m_CurPage != page->Id())) {
+            continue;
+        }
+        best->m_busy = true;
+        if (!best->m_value._getAsync(EmNexSubscription::_done, best)) {
+            best->m_busy = false;
+            return;
+        }
+        m_BudgetBytes -= best->m_value._readLen();
+    }
+}
+
+void EmNextion::_dispatchChanges() const
+{
+    EmNexSubscription* sub = m_Subscriptions;
+    while (NULL != sub) {
+        // NOTE: callback might unsubscribe
+        EmNexSubscription* next = sub->m_next;
+        if (sub->m_changed) {
+            sub->m_changed = false;
+            sub->m_callback(sub->m_context);
+        }
+        sub = next;
+    }
+}
+
+void EmNextion::_pollFrames() const
+{
+    while (_pollFrame()) {
+    }
+}
+
+bool EmNextion::WaitPending() const
+{
+    // NOTE: one frame at a time since frames following  
+    //       feedbacks might be the reply of a blocking command
+    while (m_PendingCount) {
+        if (!_pollFrame()) {
+            _idle();
+        }
+    }
+    return 0 == m_FailedCount;
+}
+
+bool EmNextion::_pollFrame() const
+{
+    if (_readFrame()) {
+        _processFrame();
+        return true;
+    }
+    if (m_PendingCount && millis() - m_PendingStartMs >= _pendingTimeout()) {
+        EM_NEX_LOG_DEBUG_F(F("Pipelined feedback timeout"));
+        _trace(TRACE_TIMEOUT, m_Pending[m_PendingHead].code);
+        // Back off: next replies of this class get more margin
+        uint8_t cls = m_Pending[m_PendingHead].cls;
+        m_LatDev4[cls] = (m_LatDev4[cls] < 0x7FFF) ? m_LatDev4[cls]*2+4 : 0xFFFF;
+#ifdef EM_NEX_STATS
+        m_Stats.cmd[m_Pending[m_PendingHead].type].timeouts++;
+#endif
+        _bResult(false);
+    }
+    return false;
+}
+
+void EmNextion::_processFrame() const
+{
+    // Pending commands get their feedback or reply in FIFO order
+    if (m_PendingCount && 
+        (_isFeedback() || m_Pending[m_PendingHead].code == m_RxCode)) {
+        _popPending(m_RxCode);
+        return;
+    } 
+    if (_isFeedback()) {
+        if (ACK_CMD_SUCCEED != m_RxCode) {
+            // Failed batch command (i.e. 'bkcmd=2')
+            m_LastError = static_cast<EmNextionRet>(m_RxCode);
+            _invalidateCache();
+            m_FailedCount++;
+        }
+        return;
+    }
+
+    // Unsolicited frames
+    EmNexEvent event;
+    memset(&event, 0, sizeof(event));
+    event.code = static_cast<EmNexEventCode>(m_RxCode);
+    switch (m_RxCode) {
+        case EVT_TOUCH:
+            event.componentId = m_RxPayload[1];
+            event.pressed = (0x01 == m_RxPayload[2]);
+            // fall through - touch event carries page id
+        case EVT_PAGE: // i.e. 'sendme' in page 'preinit' event
+            event.pageId = m_RxPayload[0];
+            m_CurPage = event.pageId;
+            m_CurPageValid = true;
+            break;
+        case EVT_TOUCH_XY:
+        case EVT_SLEEP_TOUCH_XY:
+            // Coordinates are big endian
+            event.x = (static_cast<uint16_t>(m_RxPayload[0]) << 8) | m_RxPayload[1];
+            event.y = (static_cast<uint16_t>(m_RxPayload[2]) << 8) | m_RxPayload[3];
+            event.pressed = (0x01 == m_RxPayload[4]);
+            break;
+        case EVT_WAKE_UP:
+            // Display resets elements attributes when leaving sleep mode
+            InvalidateShadows();
+            break;
+        case EVT_STARTUP:
+            if (2 != m_RxLen) {
+                return;
+            }
+            // fall through - same as ready
+        case EVT_READY:
+            // Display has been restarted: it must be initialized again
+            EM_NEX_LOG_DEBUG_F(F("Display restarted"));
+            _bResult(false);
+            m_CurPage = 0;
+            m_CurPageValid = true;
+            break;
+        case EVT_SLEEP:
+        case EVT_SD_UPGRADE:
+            break;
+        default:
+            // Not an event (e.g. an unexpected reply)
+            return;
+    }
+    _queueEvent(event);
+}
+
+void EmNextion::_queueEvent(const EmNexEvent& event) const
+{
+    _trace(TRACE_EVENT, event.code);
+    if (NULL == m_Listeners) {
+        return;
+    }
+    if (EM_NEX_MAX_EVENTS == m_EventCount) {
+        EM_NEX_LOG_DEBUG(50, "event 0x%02X lost", event.code);
+        return;
+    }
+    m_Events[(m_EventHead + m_EventCount) % EM_NEX_MAX_EVENTS] = event;
+    m_EventCount++;
+}
+
+void EmNextion::_dispatchEvents() const
+{
+    while (m_EventCount) {
+        EmNexEvent event = m_Events[m_EventHead];
+        m_EventHead = (m_EventHead + 1) % EM_NEX_MAX_EVENTS;
+        m_EventCount--;
+        for (EmNexEventListener* listener = m_Listeners; 
+             NULL != listener; 
+             listener = listener->m_nextListener) {
+            listener->OnNexEvent(event);
+        }
+    }
+}
+
+void EmNextion::AddListener(EmNexEventListener& listener) const
+{
+    listener.m_nextListener = m_Listeners;
+    m_Listeners = &listener;
+}
+
+void EmNextion::RemoveListener(EmNexEventListener& listener) const
+{
+    EmNexEventListener** next = &m_Listeners;
+    while (NULL != *next) {
+        if (*next == &listener) {
+            *next = listener.m_nextListener;
+            listener.m_nextListener = NULL;
+            return;
+        }
+        next = &(*next)->m_nextListener;
+    }
+}
+
+bool EmNextion::_isFeedback() const
+{
+    // Command feedback frames have no payload
+    return 0 == m_RxLen && m_RxCode <= MAX_FEEDBACK_CODE;
+}
+
+bool EmNextion::_readFrame() const
+{
+    for (;;) {
+        uint8_t c;
+        if (m_RxReplayPos < m_RxReplayLen) {
+            c = m_RxReplay[m_RxReplayPos++];
+        } else if (m_Serial.available()) {
+            c = static_cast<uint8_t>(m_Serial.read());
+            _statsRx();
+        } else {
+            return false;
+        }
+        if (_rxByte(c)) {
+            return true;
+        }
+    }
+}
+
+bool EmNextion::_rxByte(uint8_t c) const
+{
+    if (rxTerminators == m_RxState && c != 0xFF) {
+        // Corrupted frame: its code may be a stray byte (e.g. line 
+        // noise) swallowing a good frame, let's parse again what 
+        // followed the code (streamed texts can't be taken back)
+        uint8_t replay[sizeof(m_RxReplay)];
+        uint8_t len = 0;
+        if (ACK_STRING != m_RxCode) {
+            memcpy(replay, m_RxPayload, m_RxLen);
+            len = m_RxLen;
+            for (uint8_t i = 0; i < m_RxTerm; i++) {
+                replay[len++] = 0xFF;
+            }
+        }
+        replay[len++] = c;
+        while (m_RxReplayPos < m_RxReplayLen && len < sizeof(replay)) {
+            replay[len++] = m_RxReplay[m_RxReplayPos++];
+        }
+        memcpy(m_RxReplay, replay, len);
+        m_RxReplayPos = 0;
+        m_RxReplayLen = len;
+        m_RxState = rxCode;
+        _trace(TRACE_RESYNC, m_RxCode);
+#ifdef EM_NEX_STATS
+        m_Stats.badFrames++;
+#endif
+        return false;
+    }
+    switch (m_RxState) {
+        case rxCode:
+            m_RxCode = c;
+            m_RxLen = 0;
+            m_RxTerm = 0;
+            m_RxState = (0 == _framePayloadLen(c)) ? rxTerminators : rxPayload;
+            break;
+        case rxPayload:
+            if (FRAME_VAR_LEN == _framePayloadLen(m_RxCode)) {
+                // Variable length payload ends with terminators
+                if (c == 0xFF) {
+                    m_RxTerm = 1;
+                    m_RxState = rxTerminators;
+                } else if (ACK_STRING == m_RxCode) {
+                    // Strings are streamed to the pending command buffer
+                    if (m_PendingCount && 
+                        ACK_STRING == m_Pending[m_PendingHead].code) {
+                        _rxText(m_Pending[m_PendingHead].buf, 
+                                m_Pending[m_PendingHead].len, 
+                                c);
+                    }
+                } else if (m_RxLen < sizeof(m_RxPayload)) {
+                    m_RxPayload[m_RxLen++] = c;
+                }
+            } else {
+                m_RxPayload[m_RxLen++] = c;
+                if (m_RxLen == _framePayloadLen(m_RxCode)) {
+                    m_RxState = rxTerminators;
+                }
+            }
+            break;
+        case rxTerminators:
+            if (++m_RxTerm == 3) {
+                m_RxState = rxCode;
+                return true;
+            }
+            break;
+    }
+    return false;
+}
+
+bool EmNextion::_pushPending(uint8_t code, 
+                             char* buf, 
+                             uint16_t len,
+                             EmNexAsyncCallback callback, 
+                             void* context) const
+{
+    // Recorded commands feedbacks come first
+    if (m_BatchAcks && !_queueBatchAcks()) {
+        return false;
+    }
+    // Wait for a free slot (batched commands must be sent first!)
+    if (EM_NEX_MAX_PENDING == m_PendingCount && m_BatchLen) {
+        _flushBatch();
+    }
+    while (EM_NEX_MAX_PENDING == m_PendingCount) {
+        if (!_pollFrame()) {
+            _idle();
+        }
+        if (!m_IsInit) {
+            return false;
+        }
+    }
+    if (0 == m_PendingCount) {
+        m_PendingStartMs = millis();
+        m_RxPos = 0;
+        m_RxChanged = false;
+    }
+    PendingCmd& cmd = m_Pending[(m_PendingHead + m_PendingCount) % EM_NEX_MAX_PENDING];
+    cmd.callback = callback;
+    cmd.context = context;
+    cmd.buf = buf;
+    cmd.sentMs = millis();
+    int32_t txMs = static_cast<int32_t>(m_TxEndMs - cmd.sentMs);
+    cmd.txMs = (txMs <= 0) ? 0 : ((txMs < 0xFFFF) ? static_cast<uint16_t>(txMs) : 0xFFFF);
+    cmd.tag = ++m_CmdTag;
+    cmd.code = code;
+    cmd.cls = _latClass(code, m_PageCmd);
+    cmd.len = len;
+#ifdef EM_NEX_STATS
+    cmd.type = m_StatsType;
+#endif
+    m_PendingCount++;
+    _trace(TRACE_CMD, code, cmd.tag);
+    return true;
+}
+
+void EmNextion::_popPending(uint8_t code) const
+{
+    PendingCmd cmd = m_Pending[m_PendingHead];
+    m_PendingHead = (m_PendingHead + 1) % EM_NEX_MAX_PENDING;
+    m_PendingCount--;
+    bool prior = (0 != m_BatchPrior);
+    if (prior) {
+        m_BatchPrior--;
+    }
+    // Latency since the command was sent (i.e. commands in flight 
+    // don't share the time waited by the previous ones)
+    uint32_t now = millis();
+    uint32_t latencyMs = now - cmd.sentMs;
+    _trace(TRACE_REPLY, code, static_cast<uint16_t>((latencyMs < 0xFFFF) ? latencyMs : 0xFFFF));
+    if (NO_FEEDBACK != code) {
+        if (ACK_TRANSPARENT_DONE != cmd.code) {
+            // Data transfer time is not a latency
+            _trackLatency(cmd.cls, (latencyMs > cmd.txMs) ? latencyMs - cmd.txMs : 0);
+        }
+#ifdef EM_NEX_STATS
+        EmNexCmdStats& stats = m_Stats.cmd[cmd.type];
+        if (code != cmd.code) {
+            stats.errors[EmNexStatsErrorIndex(code)]++;
+        }
+        static const uint16_t bounds[] = { EM_NEX_STATS_LAT_BOUNDS };
+        uint8_t bucket = 0;
+        while (bucket < sizeof(bounds)/sizeof(bounds[0]) && latencyMs >= bounds[bucket]) {
+            bucket++;
+        }
+        stats.latency[bucket]++;
+#endif
+    }
+    m_PendingStartMs = now;
+    m_LastError = static_cast<EmNextionRet>((code == cmd.code) ? static_cast<uint8_t>(ACK_CMD_SUCCEED) : code);
+    if (0 == m_PendingCount && static_cast<int32_t>(m_TxEndMs - now) > 0) {
+        // All commands got answered: line was faster than estimated
+        m_TxEndMs = now;
+    }
+
+    EmGetValueResult result = EmGetValueResult::failed;
+    if (code == cmd.code) {
+        _rxReply(cmd.buf, cmd.len);
+        result = m_RxChanged ? 
+                 EmGetValueResult::succeedNotEqualValue : 
+                 EmGetValueResult::succeedEqualValue;
+    } else {
+        // Cached values might be not confirmed by display
+        _invalidateCache();
+        m_FailedCount++;
+        if (prior) {
+            // Sent before current batch
+            m_BatchFailedCount++;
+        }
+        if (ACK_STRING == cmd.code && SINK_LEN == cmd.len) {
+            reinterpret_cast<EmNexTextSink*>(cmd.buf)->Abort();
+        } else if (ACK_STRING == cmd.code && cmd.len) {
+            cmd.buf[0] = 0;
+        }
+        EM_NEX_LOG_DEBUG(50, "cmd %u failed [0x%02X]", cmd.tag, code);
+    }
+    // Next command reply starts from scratch
+    m_RxPos = 0;
+    m_RxChanged = false;
+
+    if (NULL != cmd.callback) {
+        cmd.callback(result, cmd.context);
+    } else if (NULL != m_CmdCallback) {
+        m_CmdCallback(cmd.tag, 
+                      static_cast<EmNextionRet>(code), 
+                      m_CmdContext);
+    }
+}
+
+void EmNextion::_trackLatency(uint8_t cls, uint32_t latencyMs) const
+{
+    int32_t sample = static_cast<int32_t>((latencyMs < 0x0FFF) ? latencyMs : 0x0FFF);
+    if (0 == (m_LatValid & (1 << cls))) {
+        m_LatAvg8[cls] = static_cast<uint16_t>(sample*8);
+        m_LatDev4[cls] = static_cast<uint16_t>(sample*2);
+        m_LatValid |= (1 << cls);
+        return;
+    }
+    // avg += (sample - avg)/8, dev += (|sample - avg| - dev)/4
+    int32_t err = sample - m_LatAvg8[cls]/8;
+    m_LatAvg8[cls] = static_cast<uint16_t>(m_LatAvg8[cls] + err);
+    if (err < 0) {
+        err = -err;
+    }
+    m_LatDev4[cls] = static_cast<uint16_t>(m_LatDev4[cls] + err - m_LatDev4[cls]/4);
+}
+
+uint32_t EmNextion::_pendingTimeout() const
+{
+    const PendingCmd& cmd = m_Pending[m_PendingHead];
+    uint8_t cls = cmd.cls;
+
+    // Reply transfer time (10 bits per byte) at current bauds
+    uint32_t replyLen = 4 + _framePayloadLen(cmd.code);
+    if (ACK_STRING == cmd.code) {
+        // Streamed texts length is unknown: deadline moves on 
+        // while characters keep coming
+        replyLen = 4 + ((SINK_LEN == cmd.len) ? m_RxPos + EM_NEX_MAX_CMD_LEN : cmd.len);
+    } else if (ACK_TRANSPARENT_DONE == cmd.code) {
+        // Raw data ('len') is still on its way to display
+        replyLen += cmd.len;
+    }
+    uint32_t baud = (0 != m_Baud) ? m_Baud : 9600;
+    uint32_t timeoutMs = 1 + (replyLen*10000)/baud + _txWaitMs();
+
+    if (ACK_TRANSPARENT_DONE == cmd.code || 
+        0 == (m_LatValid & (1 << cls))) {
+        return timeoutMs + m_TimeoutMs;
+    }
+    timeoutMs += m_LatAvg8[cls]/8 + m_LatDev4[cls];
+    return (timeoutMs < m_TimeoutMs) ? m_TimeoutMs : timeoutMs;
+}
+
+uint32_t EmNextion::_txWaitMs() const
+{
+    // Time the command was still being sent after waiting started
+    int32_t waitMs = static_cast<int32_t>(m_TxEndMs - m_PendingStartMs);
+    return (waitMs > 0) ? static_cast<uint32_t>(waitMs) : 0;
+}
+
+void EmNextion::_statsCmd(const char* cmd, uint16_t len) const
+{
+#ifdef EM_NEX_STATS
+    if (0 == strncmp(cmd, "get ", 4)) {
+        m_StatsType = CMD_GET;
+    } else if (0 == strncmp(cmd, "page ", 5) || 0 == strncmp(cmd, "sendme", 6)) {
+        m_StatsType = CMD_PAGE;
+    } else if (0 == strncmp(cmd, "vis ", 4)) {
+        m_StatsType = CMD_VIS;
+    } else if (0 == strncmp(cmd, "click ", 6)) {
+        m_StatsType = CMD_CLICK;
+    } else if (NULL != memchr(cmd, '=', len) && 
+               0 != strncmp(cmd, "bkcmd=", 6) && 
+               0 != strncmp(cmd, "baud=", 5)) {
+        m_StatsType = CMD_SET;
+    } else {
+        m_StatsType = CMD_OTHER;
+    }
+    m_Stats.cmd[m_StatsType].sent++;
+    m_Stats.cmd[m_StatsType].txBytes += len;
+#else
+    (void)cmd;
+    (void)len;
+#endif
+}
+
+void EmNextion::_statsTx(uint16_t len) const
+{
+#ifdef EM_NEX_STATS
+    m_Stats.cmd[m_StatsType].txBytes += len;
+#else
+    (void)len;
+#endif
+}
+
+void EmNextion::_statsRx() const
+{
+#ifdef EM_NEX_STATS
+    if (m_PendingCount) {
+        m_Stats.cmd[m_Pending[m_PendingHead].type].rxBytes++;
+    } else {
+        m_Stats.eventBytes++;
+    }
+#endif
+}
+
+void EmNextion::_trace(EmNexTraceKind kind, uint8_t code, uint16_t arg) const
+{
+#if EM_NEX_TRACE_SIZE
+    EmNexTraceRecord& record = m_Trace[(m_TraceHead + m_TraceCount) % EM_NEX_TRACE_SIZE];
+    record.timeMs = static_cast<uint16_t>(millis());
+    record.kind = kind;
+    record.code = code;
+    record.arg = arg;
+    if (EM_NEX_TRACE_SIZE == m_TraceCount) {
+        // Oldest record overwritten
+        m_TraceHead = (m_TraceHead + 1) % EM_NEX_TRACE_SIZE;
+    } else {
+        m_TraceCount++;
+    }
+#else
+    (void)kind;
+    (void)code;
+    (void)arg;
+#endif
+}
+
+#if EM_NEX_TRACE_SIZE
+uint8_t EmNextion::ReadTrace(EmNexTraceRecord* records, 
+                             uint8_t maxCount) const
+{
+    uint8_t count = 0;
+    while (m_TraceCount && count < maxCount) {
+        records[count++] = m_Trace[m_TraceHead];
+        m_TraceHead = (m_TraceHead + 1) % EM_NEX_TRACE_SIZE;
+        m_TraceCount--;
+    }
+    return count;
+}
+#endif
+
+void EmNextion::_dropPending() const
+{
+    // Link is lost: pending commands feedback won't be matched 
+    // anymore (see 'Init')
+    m_RxState = rxCode;
+    if (m_PendingCount) {
+        m_RxStale = true;
+    }
+    while (m_PendingCount) {
+        _popPending(NO_FEEDBACK);
+    }
+}
+
+bool EmNextion::_queueBatchAcks() const
+{
+    // Recorded commands got the latest tags
+    uint16_t lastTag = m_CmdTag;
+    uint16_t count = m_BatchAcks;
+    m_BatchAcks = 0;
+    m_CmdTag -= count;
+    bool res = true;
+    while (res && count--) {
+        res = _pushPending(ACK_CMD_SUCCEED, NULL, 0, NULL, NULL);
+    }
+    m_CmdTag = lastTag;
+    return res;
+}
+
+bool EmNextion::BeginBatch(char* buf, 
+                           uint16_t size, 
+                           bool failuresOnly) const
+{
+    if (IsBatch() || (!m_IsInit && !Init())) {
+        return false;
+    }
+    // Recorded commands follow the ones still waiting for feedback 
+    // (their failures are not part of this batch)
+    m_BatchPrior = m_PendingCount;
+    m_BatchBuf = buf;
+    m_BatchSize = size;
+    m_BatchLen = 0;
+    m_BatchFailuresOnly = failuresOnly;
+    m_BatchFailedCount = m_FailedCount;
+    m_BatchAcks = 0;
+    if (failuresOnly) {
+        // NOTE: 'bkcmd' feedback level applies to the 'bkcmd' command too
+        _sendCmd("bkcmd=2");
+    }
+    return true;
+}
+
+bool EmNextion::CommitBatch() const
+{
+    if (!IsBatch()) {
+        return false;
+    }
+    if (m_BatchFailuresOnly) {
+        // Restore feedback on success, its feedback ends the batch
+        _sendCmd("bkcmd=3");
+    }
+    bool res = _flushBatch();
+    m_BatchBuf = NULL;
+    if (m_BatchFailuresOnly) {
+        res = _waitBatchEnd() && res;
+    } else {
+        res = _queueBatchAcks() && res;
+        if (!m_Pipelined) {
+            WaitPending();
+        }
+    }
+    return res && m_BatchFailedCount == m_FailedCount;
+}
+
+bool EmNextion::_batchAppend(const char* data, uint16_t len) const
+{
+    if (m_BatchLen + len > m_BatchSize) {
+        if (!_flushBatch()) {
+            return false;
+        }
+        if (len > m_BatchSize) {
+            // Too big to be recorded
+            return _write(data, len);
+        }
+    }
+    memcpy(m_BatchBuf + m_BatchLen, data, len);
+    m_BatchLen += len;
+    return true;
+}
+
+bool EmNextion::_flushBatch() const
+{
+    if (0 == m_BatchLen) {
+        return true;
+    }
+    size_t len = m_BatchLen;
+    m_BatchLen = 0;
+    m_PendingStartMs = millis();
+    return _write(m_BatchBuf, len);
+}
+
+bool EmNextion::_endFailuresOnly() const
+{
+    // Failed commands feedback would be taken for the reply: 
+    // batch goes on with success feedback too
+    m_BatchFailuresOnly = false;
+    return _sendCmd("bkcmd=3") && _flushBatch() && _waitBatchEnd();
+}
+
+bool EmNextion::_waitBatchEnd() const
+{
+    // Display sends failed commands feedback and 
+    // finally the 'bkcmd=3' success feedback (once the 
+    // whole batch got through the line)
+    // NOTE: commands sent before the batch are answered first
+    WaitPending();
+    EmTimeout rxTimeout(_txWaitMs() + m_TimeoutMs);
+    while (!rxTimeout.IsElapsed(false)) {
+        if (!_readFrame()) {
+            _idle();
+            continue;
+        }
+        if (!_isFeedback()) {
+            _processFrame();
+        } else if (ACK_CMD_SUCCEED == m_RxCode) {
+            return true;
+        } else {
+            m_LastError = static_cast<EmNextionRet>(m_RxCode);
+            _invalidateCache();
+            m_FailedCount++;
+            EM_NEX_LOG_DEBUG(50, "batch cmd failed [0x%02X]", m_RxCode);
+            rxTimeout.Restart();
+        }
+    }
+    EM_NEX_LOG_DEBUG_F(F("Batch feedback timeout"));
+    return _bResult(false);
+}
+
+void EmNextion::_invalidateCache() const
+{
+    InvalidateShadows();
+    _invalidateCurPage();
+}
+
+void EmNextion::InvalidateShadows() const
+{
+    // Zero is the 'never set' shadow generation
+    if (0 == ++m_ShadowGen) {
+        m_ShadowGen = 1;
+    }
+}
+
+const char EmNexCmdBuf::TERMINATORS[] = "\xFF\xFF\xFF";
+
+EmNexCmdBuf& EmNexCmdBuf::Add(const char* str)
+{
+    uint16_t len = strlen(str);
+    if (m_len + len > m_size) {
+        m_overflow = true;
+    } else {
+        memcpy(m_buf + m_len, str, len);
+        m_len += len;
+    }
+    m_buf[m_len] = 0;
+    return *this;
+}
+
+EmNexCmdBuf& EmNexCmdBuf::Add(char c)
+{
+    char str[2] = {c, 0};
+    return Add(str);
+}
+
+EmNexCmdBuf& EmNexCmdBuf::AddNumber(int32_t value)
+{
+    char str[12];
+    return Add(to_str(str, sizeof(str), value));
+}
+
+void EmNexCmdBuf::Resize(uint16_t len)
+{
+    if (len <= m_len) {
+        m_len = len;
+        m_buf[m_len] = 0;
+        m_overflow = false;
+    }
+}
+
+void EmNexCmdBuf::End()
+{
+    // Terminators room is always available
+    if (!m_ended) {
+        memcpy(m_buf + m_len, TERMINATORS, 3);
+        m_len += 3;
+        m_ended = true;
+    }
+}